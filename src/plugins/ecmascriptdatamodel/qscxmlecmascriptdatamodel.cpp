@@ -7,19 +7,26 @@
 #include <QtScxml/private/qscxmlexecutablecontent_p.h>
 #include <QtScxml/private/qscxmlstatemachine_p.h>
 #include <QtScxml/private/qscxmldatamodel_p.h>
+#include <QtScxml/private/qscxmltabledata_p.h>
 
 #include <qjsengine.h>
+#include <qjsonarray.h>
 #include <qjsondocument.h>
+#include <qjsonobject.h>
+#include <qset.h>
 #include <QtQml/private/qjsvalue_p.h>
+#include <QtQml/private/qv4functionobject_p.h>
 #include <QtQml/private/qv4scopedvalue_p.h>
 
 #include <functional>
+#include <vector>
 
 QT_BEGIN_NAMESPACE
 
 Q_LOGGING_CATEGORY(qscxmlEsLog, "qt.scxml.statemachine")
 
 using namespace QScxmlExecutableContent;
+using QScxmlInternal::GeneratedTableData;
 
 typedef std::function<QString (bool *)> ToStringEvaluator;
 typedef std::function<bool (bool *)> ToBoolEvaluator;
@@ -35,32 +42,114 @@ public:
         : jsEngine(nullptr)
     {}
 
-    QString evalStr(const QString &expr, const QString &context, bool *ok)
+    // Expressions are compiled into functions once per evaluator, and then just called on every
+    // evaluation. The same expression can be evaluated in different ways, so each way gets its
+    // own cache. If qscxmlc has pre-compiled the expressions, the caches are filled from its
+    // module when the first expression is evaluated.
+    typedef GeneratedTableData::EcmaScriptFunctionKind FunctionKind;
+
+    QString evalStr(EvaluatorId id, const EvaluatorInfo &info, bool *ok)
     {
-        QString script = QStringLiteral("(%1).toString()").arg(expr);
-        QJSValue v = eval(script, context, ok);
+        QJSValue v = call(GeneratedTableData::StringFunction, id, info.expr, info.context, ok);
         if (*ok)
             return v.toString();
         else
             return QString();
     }
 
-    bool evalBool(const QString &expr, const QString &context, bool *ok)
+    bool evalBool(EvaluatorId id, const EvaluatorInfo &info, bool *ok)
     {
-        QString script = QStringLiteral("(function(){return !!(%1); })()").arg(expr);
-        QJSValue v = eval(script, context, ok);
+        QJSValue v = call(GeneratedTableData::BoolFunction, id, info.expr, info.context, ok);
         if (*ok)
             return v.toBool();
         else
             return false;
     }
 
-    QJSValue evalJSValue(const QString &expr, const QString &context, bool *ok)
+    QJSValue evalJSValue(EvaluatorId id, const EvaluatorInfo &info, bool *ok)
+    {
+        return call(GeneratedTableData::ValueFunction, id, info.expr, info.context, ok);
+    }
+
+    QJSValue evalJSValue(EvaluatorId id, const AssignmentInfo &info, bool *ok)
+    {
+        return call(GeneratedTableData::AssignmentFunction, id, info.expr, info.context, ok);
+    }
+
+    QJSValue call(FunctionKind kind, EvaluatorId id, StringId expr, StringId context, bool *ok)
     {
-        assertEngine();
+        Q_ASSERT(ok);
+        Q_ASSERT(id >= 0);
+
+        if (!ecmaScriptModuleLoaded)
+            loadEcmaScriptModule();
+
+        std::vector<QJSValue> &cache = compiledFunctions[kind];
+        if (size_t(id) >= cache.size())
+            cache.resize(size_t(id) + 1);
+        QJSValue &function = cache[size_t(id)];
+
+        if (!function.isCallable()) {
+            QJSValue compiled = compile(kind, string(expr));
+            if (compiled.isError()) {
+                *ok = false;
+                submitError(QStringLiteral("error.execution"),
+                            QStringLiteral("%1 in %2").arg(compiled.toString(), string(context)));
+                return QJSValue(QJSValue::UndefinedValue);
+            }
+            function = compiled;
+        }
 
-        QString script = QStringLiteral("(function(){'use strict'; return (\n%1\n); })()").arg(expr);
-        return eval(script, context, ok);
+        // Strings used to be evaluated at the top level, where "this" is the global object.
+        QJSValue v = kind == GeneratedTableData::StringFunction ? function.callWithInstance(dataModel)
+                                            : function.call();
+        if (v.isError()) {
+            *ok = false;
+            submitError(QStringLiteral("error.execution"),
+                        QStringLiteral("%1 in %2").arg(v.toString(), string(context)));
+            return QJSValue(QJSValue::UndefinedValue);
+        } else {
+            *ok = true;
+            return v;
+        }
+    }
+
+    QJSValue compile(FunctionKind kind, const QString &expr)
+    {
+        return assertEngine()->evaluate(
+                    QLatin1Char('(') + GeneratedTableData::ecmaScriptFunction(kind, expr)
+                    + QLatin1Char(')'), QStringLiteral("<expr>"), 0);
+    }
+
+    // The module generated by qscxmlc evaluates to one array of functions per function kind,
+    // indexed by evaluator or assignment id. Holes are compiled on demand.
+    void loadEcmaScriptModule()
+    {
+        QJSEngine *engine = assertEngine();
+        ecmaScriptModuleLoaded = true;
+
+        auto stateTable = reinterpret_cast<const StateTable *>(
+                    m_stateMachine->tableData()->stateMachineTable());
+        if (stateTable->ecmaScriptModule == StateTable::InvalidIndex)
+            return;
+
+        QJSValue module = engine->evaluate(string(stateTable->ecmaScriptModule),
+                                           QStringLiteral("<module>"), 0);
+        if (module.isError()) {
+            // Compile the expressions one by one, so that each of them reports its own error.
+            qCDebug(qscxmlEsLog) << m_stateMachine << "cannot load pre-compiled expressions:"
+                                 << module.toString();
+            return;
+        }
+
+        for (int kind = 0; kind < GeneratedTableData::FunctionKindCount; ++kind) {
+            const QJSValue functions = module.property(quint32(kind));
+            const quint32 length = functions.property(QStringLiteral("length")).toUInt();
+            std::vector<QJSValue> &cache = compiledFunctions[kind];
+            cache.resize(length);
+            for (quint32 i = 0; i < length; ++i)
+                cache[i] = functions.property(i);
+        }
     }
 
     QJSValue eval(const QString &script, const QString &context, bool *ok)
@@ -109,20 +198,118 @@ public:
         auto platformVars = QScxmlPlatformProperties::create(engine, m_stateMachine);
         dataModel.setProperty(QStringLiteral("_x"), platformVars->jsValue());
 
-        dataModel.setProperty(QStringLiteral("In"), engine->evaluate(
-                                  QStringLiteral("(function(id){return _x.inState(id);})")));
+        // In() remembers the index of each state it is asked about, so that afterwards it only
+        // needs to test a bit in the configuration.
+        QJSValue in = engine->evaluate(QStringLiteral(
+                "(function(x) {\n"
+                "    var indexes = Object.create(null);\n"
+                "    return function(id) {\n"
+                "        var index = indexes[id];\n"
+                "        if (index === undefined)\n"
+                "            index = indexes[id] = x.stateIndex(id);\n"
+                "        return x.isStateActive(index);\n"
+                "    };\n"
+                "})"), QStringLiteral("<expr>"), 0);
+        dataModel.setProperty(QStringLiteral("In"),
+                              in.call(QJSValueList() << platformVars->jsValue()));
     }
 
-    void assignEvent(const QScxmlEvent &event)
+    // Defines all <data> names, and applies the initial values passed by <invoke>, with a
+    // single call into the engine. Returns false if that fails, for example because a name
+    // is read-only. The caller then falls back to setting one property at a time, which
+    // reports the exact error.
+    bool initializeData(const QStringList &names, const QVariantMap &initialDataValues)
+    {
+        QJSEngine *engine = assertEngine();
+        const QJSValue initializer = dataInitializer(names);
+        if (!initializer.isCallable())
+            return false;
+
+        const QJSValue initial = initialDataValues.isEmpty()
+                ? QJSValue(QJSValue::NullValue) : engine->toScriptValue(initialDataValues);
+        return !initializer.call(QJSValueList() << dataModel << initial).isError();
+    }
+
+    // The initializer defines all names of the chart as own properties of the data model, from a
+    // set of property descriptors. Like setting them one by one, this does not run inherited
+    // setters, and inherited read-only properties are shadowed. Existing non-configurable
+    // properties make it throw.
+    QJSValue dataInitializer(const QStringList &names)
+    {
+        QJSEngine *engine = assertEngine();
+        const QJSValue factory = engine->evaluate(QStringLiteral(
+                "(function(names) {\n"
+                "    function descriptor(value) {\n"
+                "        return { value: value, writable: true, enumerable: true,"
+                " configurable: true };\n"
+                "    }\n"
+                "    var descriptors = Object.create(null);\n"
+                "    for (var i = 0; i < names.length; ++i)\n"
+                "        descriptors[names[i]] = descriptor(undefined);\n"
+                "    return function(target, initial) {\n"
+                "        'use strict';\n"
+                "        Object.defineProperties(target, descriptors);\n"
+                "        if (initial) {\n"
+                "            for (var key in initial) {\n"
+                "                if (key in descriptors)\n"
+                "                    Object.defineProperty(target, key, descriptor(initial[key]));\n"
+                "            }\n"
+                "        }\n"
+                "    };\n"
+                "})"), QStringLiteral("<data>"), 0);
+        if (factory.isError())
+            return factory;
+
+        return factory.call(QJSValueList() << engine->toScriptValue(names));
+    }
+
+    void setPendingEvent(const QScxmlEvent &event)
     {
         if (event.name().isEmpty())
             return;
 
+        pendingEvent = event;
+        hasPendingEvent = true;
+    }
+
+    // Only builds the _event object when some code is about to run that might look at it.
+    // The compiler tells us whether any expression or script mentions _event at all. If none
+    // does, code can still reach it indirectly, for example as this['_' + 'event'], so _event
+    // becomes an accessor that binds the pending event when it is read. Accessing the _event
+    // property from C++ always binds it.
+    void bindPendingEvent(bool force = false)
+    {
+        if (!hasPendingEvent)
+            return;
+        if (force || eventVariableUsed) {
+            hasPendingEvent = false;
+            assignEvent(pendingEvent);
+        } else if (!eventAccessorInstalled) {
+            installEventAccessor();
+        }
+    }
+
+    QJSValue loadPendingEvent()
+    {
+        if (!hasPendingEvent)
+            return QJSValue(QJSValue::UndefinedValue);
+        bindPendingEvent(true);
+        return property(QStringLiteral("_event"));
+    }
+
+    void bindPendingEvent(const QString &propertyName)
+    {
+        bindPendingEvent(propertyName == QLatin1String("_event"));
+    }
+
+    void assignEvent(const QScxmlEvent &event)
+    {
         QJSEngine *engine = assertEngine();
         QJSValue _event = engine->newObject();
-        QJSValue dataValue = eventDataAsJSValue(event.data());
-        _event.setProperty(QStringLiteral("data"), dataValue.isUndefined() ? QJSValue(QJSValue::UndefinedValue)
-                                                                           : dataValue);
+        if (isLargeEventData(event.data()))
+            setLazyEventData(&_event, event);
+        else
+            _event.setProperty(QStringLiteral("data"), eventDataAsJSValue(engine, event));
         _event.setProperty(QStringLiteral("invokeid"), event.invokeId().isEmpty() ? QJSValue(QJSValue::UndefinedValue)
                                                                                   : engine->toScriptValue(event.invokeId()));
         if (!event.originType().isEmpty())
@@ -138,37 +325,168 @@ public:
             _event.setProperty(QStringLiteral("errorMessage"), event.errorMessage());
 
         setReadonlyProperty(&dataModel, QStringLiteral("_event"), _event);
+        eventAccessorInstalled = false;
     }
 
-    QJSValue eventDataAsJSValue(const QVariant &eventData)
+    // The accessor stays in place for all events that are not read. Binding an event replaces
+    // it with the plain read-only property.
+    void installEventAccessor()
     {
-        if (!eventData.isValid()) {
-            return QJSValue(QJSValue::UndefinedValue);
+        QJSEngine *engine = assertEngine();
+        if (!eventGetter.isCallable()) {
+            Q_Q(QScxmlEcmaScriptDataModel);
+            const QJSValue factory = engine->evaluate(QStringLiteral(
+                    "(function(binding) { return function() { return binding.load(); }; })"),
+                    QStringLiteral("<event>"), 0);
+            eventGetter = factory.call(QJSValueList() << engine->newQObject(
+                                           new QScxmlEcmaScriptEventBinding(this, q)));
         }
 
+        if (setReadonlyAccessor(&dataModel, QStringLiteral("_event"), eventGetter))
+            eventAccessorInstalled = true;
+        else
+            assignEvent(pendingEvent);
+    }
+
+    // Big payloads are only converted when a script reads _event.data. Until then, the property
+    // is an accessor that replaces itself with the converted data.
+    void setLazyEventData(QJSValue *_event, const QScxmlEvent &event)
+    {
         QJSEngine *engine = assertEngine();
-        if (eventData.canConvert<QVariantMap>()) {
-            auto keyValues = eventData.value<QVariantMap>();
-            auto data = engine->newObject();
+        if (!lazyEventData.isCallable()) {
+            lazyEventData = engine->evaluate(QStringLiteral(
+                    "(function(event, loader) {\n"
+                    "    function define(value) {\n"
+                    "        Object.defineProperty(event, 'data', { value: value, writable: true,"
+                    " enumerable: true, configurable: true });\n"
+                    "        return value;\n"
+                    "    }\n"
+                    "    Object.defineProperty(event, 'data', { enumerable: true, configurable: true,\n"
+                    "        get: function() { return define(loader.load()); },\n"
+                    "        set: define });\n"
+                    "})"), QStringLiteral("<event>"), 0);
+        }
 
-            for (QVariantMap::const_iterator it = keyValues.begin(), eit = keyValues.end(); it != eit; ++it) {
-                data.setProperty(it.key(), engine->toScriptValue(it.value()));
-            }
+        // The loader has no parent, so the engine owns it.
+        QJSValue loader = engine->newQObject(new QScxmlEcmaScriptEventData(event));
+        lazyEventData.call(QJSValueList() << *_event << loader);
+    }
 
-            return data;
+    static bool isLargeEventData(const QVariant &data)
+    {
+        enum { MaxEagerEntries = 64, MaxEagerLength = 4096 };
+        const void *value = data.constData();
+        switch (data.metaType().id()) {
+        case QMetaType::QVariantMap:
+            return static_cast<const QVariantMap *>(value)->size() > MaxEagerEntries;
+        case QMetaType::QVariantHash:
+            return static_cast<const QVariantHash *>(value)->size() > MaxEagerEntries;
+        case QMetaType::QVariantList:
+            return static_cast<const QVariantList *>(value)->size() > MaxEagerEntries;
+        case QMetaType::QJsonObject:
+            return static_cast<const QJsonObject *>(value)->size() > MaxEagerEntries;
+        case QMetaType::QJsonArray:
+            return static_cast<const QJsonArray *>(value)->size() > MaxEagerEntries;
+        case QMetaType::QString:
+            return static_cast<const QString *>(value)->size() > MaxEagerLength;
+        case QMetaType::QByteArray:
+            return static_cast<const QByteArray *>(value)->size() > MaxEagerLength;
+        default:
+            return false;
         }
+    }
 
-        if (eventData == QVariant(QMetaType(QMetaType::VoidStar), nullptr)) {
-            return QJSValue(QJSValue::NullValue);
+    template<typename Map>
+    static QJSValue objectFromMap(QJSEngine *engine, const Map &keyValues)
+    {
+        QJSValue data = engine->newObject();
+        for (auto it = keyValues.cbegin(), eit = keyValues.cend(); it != eit; ++it)
+            data.setProperty(it.key(), engine->toScriptValue(it.value()));
+        return data;
+    }
+
+    static QJSValue eventDataAsJSValue(QJSEngine *engine, const QScxmlEvent &event)
+    {
+        const QVariant eventData = event.data();
+        const void *value = eventData.constData();
+        switch (eventData.metaType().id()) {
+        case QMetaType::UnknownType:
+            return QJSValue(QJSValue::UndefinedValue);
+        case QMetaType::QVariantMap:
+            return objectFromMap(engine, *static_cast<const QVariantMap *>(value));
+        case QMetaType::QVariantHash:
+            return objectFromMap(engine, *static_cast<const QVariantHash *>(value));
+        case QMetaType::QJsonObject:
+        case QMetaType::QJsonArray:
+        case QMetaType::QJsonValue:
+            // The engine converts these directly, without going through QVariantMap.
+            return engine->toScriptValue(eventData);
+        case QMetaType::QJsonDocument:
+            return jsonDocumentAsJSValue(engine, *static_cast<const QJsonDocument *>(value));
+        case QMetaType::VoidStar:
+            if (!*static_cast<void * const *>(value))
+                return QJSValue(QJSValue::NullValue);
+            break;
+        case QMetaType::QString:
+        case QMetaType::QByteArray:
+            return stringAsJSValue(engine, event);
+        default:
+            break;
         }
 
-        QString data = eventData.toString();
+        if (eventData.canConvert<QVariantMap>())
+            return objectFromMap(engine, eventData.value<QVariantMap>());
+
+        return stringAsJSValue(engine, event);
+    }
+
+    // Strings that contain JSON are converted to the structure they describe.
+    static QJSValue stringAsJSValue(QJSEngine *engine, const QScxmlEvent &event)
+    {
+        const QJsonDocument doc = parsedJsonData(event);
+        if (!doc.isNull())
+            return jsonDocumentAsJSValue(engine, doc);
+        else
+            return engine->toScriptValue(event.data().toString());
+    }
+
+    // Returns the data of the event parsed as a JSON document, or a null document if the data
+    // is not a JSON object or array.
+    static QJsonDocument parsedJsonData(const QScxmlEvent &event)
+    {
+        if (event.isErrorEvent())
+            return QJsonDocument();
+
+        const QVariant data = event.data();
+        const QByteArray json = data.metaType().id() == QMetaType::QByteArray
+                ? data.toByteArray() : data.toString().toUtf8();
+        if (!mayBeJson(json))
+            return QJsonDocument();
+
         QJsonParseError err;
-        QJsonDocument doc = QJsonDocument::fromJson(data.toUtf8(), &err);
-        if (err.error == QJsonParseError::NoError)
-            return engine->toScriptValue(doc.toVariant());
+        const QJsonDocument doc = QJsonDocument::fromJson(json, &err);
+        return err.error == QJsonParseError::NoError ? doc : QJsonDocument();
+    }
+
+    // Only objects and arrays can be parsed into a QJsonDocument.
+    static bool mayBeJson(const QByteArray &data)
+    {
+        for (char c : data) {
+            if (c == ' ' || c == '\t' || c == '\n' || c == '\r')
+                continue;
+            return c == '{' || c == '[';
+        }
+        return false;
+    }
+
+    static QJSValue jsonDocumentAsJSValue(QJSEngine *engine, const QJsonDocument &doc)
+    {
+        if (doc.isArray())
+            return engine->toScriptValue(doc.array());
+        else if (doc.isObject())
+            return engine->toScriptValue(doc.object());
         else
-            return engine->toScriptValue(data);
+            return QJSValue(QJSValue::NullValue);
     }
 
     QJSEngine *assertEngine()
@@ -187,7 +505,15 @@ public:
     }
 
     void setEngine(QJSEngine *engine)
-    { jsEngine = engine; }
+    {
+        jsEngine = engine;
+        ecmaScriptModuleLoaded = false;
+        lazyEventData = QJSValue();
+        eventGetter = QJSValue();
+        eventAccessorInstalled = false;
+        for (std::vector<QJSValue> &cache : compiledFunctions)
+            cache.clear();
+    }
 
     QString string(StringId id) const
     {
@@ -223,13 +549,83 @@ public:
         return false;
     }
 
+    // Checks that the item of a <foreach> can be declared as a variable. Each name is only
+    // compiled once.
+    bool isValidForeachItem(const QString &item)
+    {
+        if (validForeachItems.contains(item))
+            return true;
+
+        QJSEngine *engine = assertEngine();
+        if (engine->evaluate(QStringLiteral("(function(){var %1 = 0})()").arg(item)).isError())
+            return false;
+        validForeachItems.insert(item);
+        return true;
+    }
+
+    // Iterates over a shallow copy of the array, as the body may modify it (see 4.6 of the
+    // SCXML specification). Only the first iteration assigns the item and index with the full
+    // error reporting. After that the properties are known to be writable, and are overwritten
+    // directly, with keys that are created once for the whole loop.
+    void runForeach(const QJSValue &jsArray, const QString &item, const QString &index,
+                    const QString &context, QScxmlDataModel::ForeachLoopBody *body, bool *ok)
+    {
+        const quint32 length = jsArray.property(QStringLiteral("length")).toUInt();
+        std::vector<QJSValue> items;
+        items.reserve(length);
+        for (quint32 i = 0; i < length; ++i)
+            items.push_back(jsArray.property(i));
+
+        const bool hasIndex = !index.isEmpty();
+        QV4::ExecutionEngine *engine = QJSValuePrivate::engine(&dataModel);
+        Q_ASSERT(engine);
+        QV4::Scope scope(engine);
+        QV4::ScopedObject o(scope, QJSValuePrivate::asManagedType<QV4::Object>(&dataModel));
+        QV4::ScopedString itemName(scope, engine->newString(item));
+        QV4::ScopedString indexName(scope, hasIndex ? engine->newString(index) : nullptr);
+        QV4::ScopedValue v(scope);
+
+        for (quint32 i = 0; i < length; ++i) {
+            if (i == 0 || !o) {
+                *ok = setProperty(item, items[i], context)
+                        && (!hasIndex || setProperty(index, QJSValue(i), context));
+                if (!*ok)
+                    return;
+            } else {
+                v = QJSValuePrivate::convertToReturnedValue(engine, items[i]);
+                o->insertMember(itemName, v);
+                if (hasIndex) {
+                    v = QV4::Value::fromUInt32(i);
+                    o->insertMember(indexName, v);
+                }
+                if (engine->hasException) {
+                    engine->catchException();
+                    *ok = false;
+                    submitError(QStringLiteral("error.execution"),
+                                QStringLiteral("assignment to property %1 failed in %2")
+                                .arg(item, context));
+                    return;
+                }
+            }
+
+            body->run(ok);
+            if (!*ok)
+                return;
+        }
+        *ok = true;
+    }
+
     void submitError(const QString &type, const QString &msg, const QString &sendid = QString())
     {
         QScxmlStateMachinePrivate::get(m_stateMachine)->submitError(type, msg, sendid);
     }
 
 public:
-    QStringList initialDataNames;
+    QSet<QString> initialDataNames;
+    QSet<QString> validForeachItems;
+    QScxmlEvent pendingEvent;
+    bool hasPendingEvent = false;
+    bool eventVariableUsed = true;
 
 private: // Uses private API
     static void setReadonlyProperty(QJSValue *object, const QString &name, const QJSValue &value)
@@ -261,6 +657,33 @@ private: // Uses private API
             engine->catchException();
     }
 
+    // Defines a getter without a setter, so assignments fail just like for setReadonlyProperty().
+    static bool setReadonlyAccessor(QJSValue *object, const QString &name, const QJSValue &getter)
+    {
+        QV4::ExecutionEngine *engine = QJSValuePrivate::engine(object);
+        Q_ASSERT(engine);
+        QV4::Scope scope(engine);
+
+        QV4::ScopedObject o(scope, QJSValuePrivate::asManagedType<QV4::Object>(object));
+        QV4::ScopedFunctionObject f(scope, QJSValuePrivate::asManagedType<QV4::FunctionObject>(&getter));
+        if (!o || !f)
+            return false;
+
+        QV4::ScopedString s(scope, engine->newString(name));
+        QV4::ScopedProperty p(scope);
+        p->setGetter(f);
+        p->setSetter(nullptr);
+        QV4::PropertyAttributes attributes(QV4::Attr_Accessor);
+        attributes.setConfigurable(false);
+        attributes.setEnumerable(false);
+        o->insertMember(s, p, attributes);
+        if (engine->hasException) {
+            engine->catchException();
+            return false;
+        }
+        return true;
+    }
+
     enum SetPropertyResult {
         SetPropertySucceeded,
         SetReadOnlyPropertyFailed,
@@ -306,8 +729,26 @@ private: // Uses private API
 private:
     QJSEngine *jsEngine;
     QJSValue dataModel;
+    std::vector<QJSValue> compiledFunctions[GeneratedTableData::FunctionKindCount];
+    bool ecmaScriptModuleLoaded = false;
+    QJSValue lazyEventData;
+    QJSValue eventGetter;
+    bool eventAccessorInstalled = false;
 };
 
+QJSValue QScxmlEcmaScriptEventBinding::load()
+{
+    return m_dataModel->loadPendingEvent();
+}
+
+QJSValue QScxmlEcmaScriptEventData::load()
+{
+    QJSEngine *engine = qjsEngine(this);
+    if (!engine)
+        return QJSValue(QJSValue::UndefinedValue);
+    return QScxmlEcmaScriptDataModelPrivate::eventDataAsJSValue(engine, m_event);
+}
+
 /*
  * The QScxmlEcmaScriptDataModel class is the ECMAScript data model for
  * a Qt SCXML state machine.
@@ -331,23 +772,35 @@ bool QScxmlEcmaScriptDataModel::setup(const QVariantMap &initialDataValues)
     Q_D(QScxmlEcmaScriptDataModel);
     d->setupDataModel();
 
+    auto stateTable = reinterpret_cast<const StateTable *>(
+                d->m_stateMachine->tableData()->stateMachineTable());
+    d->eventVariableUsed = stateTable->flags & StateTable::EventVariableUsed;
+
     bool ok = true;
-    QJSValue undefined(QJSValue::UndefinedValue); // See B.2.1, and test456.
     int count;
-    StringId *names = d->m_stateMachine->tableData()->dataNames(&count);
-    for (int i = 0; i < count; ++i) {
-        auto name = d->string(names[i]);
-        QJSValue v = undefined;
-        QVariantMap::const_iterator it = initialDataValues.find(name);
-        if (it != initialDataValues.end()) {
-            QJSEngine *engine = d->assertEngine();
-            v = engine->toScriptValue(it.value());
-        }
-        if (!d->setProperty(name, v, QStringLiteral("<data>"))) {
-            ok = false;
+    StringId *nameIds = d->m_stateMachine->tableData()->dataNames(&count);
+    QStringList names;
+    names.reserve(count);
+    for (int i = 0; i < count; ++i)
+        names.append(d->string(nameIds[i]));
+
+    // All data is undefined until its <data> element is evaluated. See B.2.1, and test456.
+    if (!names.isEmpty() && !d->initializeData(names, initialDataValues)) {
+        QJSValue undefined(QJSValue::UndefinedValue);
+        for (const QString &name : std::as_const(names)) {
+            QJSValue v = undefined;
+            QVariantMap::const_iterator it = initialDataValues.find(name);
+            if (it != initialDataValues.end()) {
+                QJSEngine *engine = d->assertEngine();
+                v = engine->toScriptValue(it.value());
+            }
+            if (!d->setProperty(name, v, QStringLiteral("<data>"))) {
+                ok = false;
+            }
         }
     }
-    d->initialDataNames = initialDataValues.keys();
+    const QStringList initialNames = initialDataValues.keys();
+    d->initialDataNames = QSet<QString>(initialNames.begin(), initialNames.end());
 
     return ok;
 }
@@ -356,33 +809,37 @@ QString QScxmlEcmaScriptDataModel::evaluateToString(QScxmlExecutableContent::Eva
                                                     bool *ok)
 {
     Q_D(QScxmlEcmaScriptDataModel);
+    d->bindPendingEvent();
     const EvaluatorInfo &info = d->m_stateMachine->tableData()->evaluatorInfo(id);
 
-    return d->evalStr(d->string(info.expr), d->string(info.context), ok);
+    return d->evalStr(id, info, ok);
 }
 
 bool QScxmlEcmaScriptDataModel::evaluateToBool(QScxmlExecutableContent::EvaluatorId id,
                                                bool *ok)
 {
     Q_D(QScxmlEcmaScriptDataModel);
+    d->bindPendingEvent();
     const EvaluatorInfo &info = d->m_stateMachine->tableData()->evaluatorInfo(id);
 
-    return d->evalBool(d->string(info.expr), d->string(info.context), ok);
+    return d->evalBool(id, info, ok);
 }
 
 QVariant QScxmlEcmaScriptDataModel::evaluateToVariant(QScxmlExecutableContent::EvaluatorId id,
                                                       bool *ok)
 {
     Q_D(QScxmlEcmaScriptDataModel);
+    d->bindPendingEvent();
     const EvaluatorInfo &info = d->m_stateMachine->tableData()->evaluatorInfo(id);
 
-    return d->evalJSValue(d->string(info.expr), d->string(info.context), ok).toVariant();
+    return d->evalJSValue(id, info, ok).toVariant();
 }
 
 void QScxmlEcmaScriptDataModel::evaluateToVoid(QScxmlExecutableContent::EvaluatorId id,
                                                bool *ok)
 {
     Q_D(QScxmlEcmaScriptDataModel);
+    d->bindPendingEvent();
     const EvaluatorInfo &info = d->m_stateMachine->tableData()->evaluatorInfo(id);
 
     d->eval(d->string(info.expr), d->string(info.context), ok);
@@ -392,6 +849,7 @@ void QScxmlEcmaScriptDataModel::evaluateAssignment(QScxmlExecutableContent::Eval
                                                    bool *ok)
 {
     Q_D(QScxmlEcmaScriptDataModel);
+    d->bindPendingEvent();
     Q_ASSERT(ok);
 
     const AssignmentInfo &info = d->m_stateMachine->tableData()->assignmentInfo(id);
@@ -399,7 +857,7 @@ void QScxmlEcmaScriptDataModel::evaluateAssignment(QScxmlExecutableContent::Eval
     QString dest = d->string(info.dest);
 
     if (hasScxmlProperty(dest)) {
-        QJSValue v = d->evalJSValue(d->string(info.expr), d->string(info.context), ok);
+        QJSValue v = d->evalJSValue(id, info, ok);
         if (*ok)
             *ok = d->setProperty(dest, v, d->string(info.context));
     } else {
@@ -427,6 +885,7 @@ void QScxmlEcmaScriptDataModel::evaluateForeach(QScxmlExecutableContent::Evaluat
                                                 ForeachLoopBody *body)
 {
     Q_D(QScxmlEcmaScriptDataModel);
+    d->bindPendingEvent();
     Q_ASSERT(ok);
     Q_ASSERT(body);
     const ForeachInfo &info = d->m_stateMachine->tableData()->foreachInfo(id);
@@ -439,52 +898,33 @@ void QScxmlEcmaScriptDataModel::evaluateForeach(QScxmlExecutableContent::Evaluat
     }
 
     QString item = d->string(info.item);
-
-    QJSEngine *engine = d->assertEngine();
-    if (engine->evaluate(QStringLiteral("(function(){var %1 = 0})()").arg(item)).isError()) {
+    if (!d->isValidForeachItem(item)) {
         d->submitError(QStringLiteral("error.execution"), QStringLiteral("invalid item '%1' in %2")
-                      .arg(d->string(info.item), d->string(info.context)));
+                      .arg(item, d->string(info.context)));
         *ok = false;
         return;
     }
 
-    const int length = jsArray.property(QStringLiteral("length")).toInt();
-    QString idx = d->string(info.index);
-    QString context = d->string(info.context);
-    const bool hasIndex = !idx.isEmpty();
-
-    for (int currentIndex = 0; currentIndex < length; ++currentIndex) {
-        QJSValue currentItem = jsArray.property(static_cast<quint32>(currentIndex));
-        *ok = d->setProperty(item, currentItem, context);
-        if (!*ok)
-            return;
-        if (hasIndex) {
-            *ok = d->setProperty(idx, currentIndex, context);
-            if (!*ok)
-                return;
-        }
-        body->run(ok);
-        if (!*ok)
-            return;
-    }
-    *ok = true;
+    d->runForeach(jsArray, item, d->string(info.index), d->string(info.context), body, ok);
 }
 
 void QScxmlEcmaScriptDataModel::setScxmlEvent(const QScxmlEvent &event)
 {
     Q_D(QScxmlEcmaScriptDataModel);
-    d->assignEvent(event);
+    d->setPendingEvent(event);
 }
 
 QVariant QScxmlEcmaScriptDataModel::scxmlProperty(const QString &name) const
 {
     Q_D(const QScxmlEcmaScriptDataModel);
+    const_cast<QScxmlEcmaScriptDataModelPrivate *>(d)->bindPendingEvent(name);
     return d->property(name).toVariant();
 }
 
 bool QScxmlEcmaScriptDataModel::hasScxmlProperty(const QString &name) const
 {
     Q_D(const QScxmlEcmaScriptDataModel);
+    const_cast<QScxmlEcmaScriptDataModelPrivate *>(d)->bindPendingEvent(name);
     return d->hasProperty(name);
 }
 
@@ -492,6 +932,7 @@ bool QScxmlEcmaScriptDataModel::setScxmlProperty(const QString &name, const QVar
                                                  const QString &context)
 {
     Q_D(QScxmlEcmaScriptDataModel);
+    d->bindPendingEvent(name);
     Q_ASSERT(hasScxmlProperty(name));
 
     QJSEngine *engine = d->assertEngine();
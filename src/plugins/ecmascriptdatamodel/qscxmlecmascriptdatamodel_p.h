@@ -18,6 +18,8 @@
 #include <QObject>
 #include <QtScxml/qscxmlglobals.h>
 #include <QtScxml/qscxmldatamodel.h>
+#include <QtScxml/qscxmlevent.h>
+#include <QtQml/qjsvalue.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -47,6 +49,37 @@ public:
     bool setScxmlProperty(const QString &name, const QVariant &value, const QString &context) override;
 };
 
+// Converts the data of an event when a script first reads it.
+class QScxmlEcmaScriptEventData: public QObject
+{
+    Q_OBJECT
+public:
+    explicit QScxmlEcmaScriptEventData(const QScxmlEvent &event)
+        : m_event(event)
+    {}
+
+    Q_INVOKABLE QJSValue load();
+
+private:
+    QScxmlEvent m_event;
+};
+
+// Binds the pending event when a script reads _event through an accessor, which the data model
+// installs instead of binding every event up front.
+class QScxmlEcmaScriptEventBinding: public QObject
+{
+    Q_OBJECT
+public:
+    QScxmlEcmaScriptEventBinding(QScxmlEcmaScriptDataModelPrivate *dataModel, QObject *parent)
+        : QObject(parent), m_dataModel(dataModel)
+    {}
+
+    Q_INVOKABLE QJSValue load();
+
+private:
+    QScxmlEcmaScriptDataModelPrivate *m_dataModel;
+};
+
 QT_END_NAMESPACE
 
 #endif // QSCXMLECMASCRIPTDATAMODEL_P_H
@@ -3,6 +3,7 @@
 
 #include "qscxmlecmascriptplatformproperties_p.h"
 #include "qscxmlstatemachine.h"
+#include <QtScxml/private/qscxmlstatemachine_p.h>
 
 #include <qjsengine.h>
 
@@ -62,4 +63,14 @@ bool QScxmlPlatformProperties::inState(const QString &stateName)
     return stateMachine()->isActive(stateName);
 }
 
+int QScxmlPlatformProperties::stateIndex(const QString &stateName) const
+{
+    return QScxmlStateMachinePrivate::get(stateMachine())->stateIndexForName(stateName);
+}
+
+bool QScxmlPlatformProperties::isStateActive(int stateIndex) const
+{
+    return QScxmlStateMachinePrivate::get(stateMachine())->isStateActive(stateIndex);
+}
+
 QT_END_NAMESPACE
@@ -44,6 +44,8 @@ public:
     QString marks() const;
 
     Q_INVOKABLE bool inState(const QString &stateName);
+    Q_INVOKABLE int stateIndex(const QString &stateName) const;
+    Q_INVOKABLE bool isStateActive(int stateIndex) const;
 
 private:
     class Data;
@@ -0,0 +1,968 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "qscxmlcompiledchart_p.h"
+#include "qscxmlcompiler_p.h"
+#include "qscxmlexecutablecontent_p.h"
+
+#include <QtCore/qthreadpool.h>
+
+#ifndef BUILD_QSCXMLC
+#include <QtCore/qdatetime.h>
+#include <QtCore/qfile.h>
+#include <QtCore/qfileinfo.h>
+#include <QtCore/qhash.h>
+#include <QtCore/qmutex.h>
+#endif
+
+#include <cstring>
+
+QT_BEGIN_NAMESPACE
+
+using namespace QScxmlExecutableContent;
+
+namespace QScxmlInternal {
+
+using namespace CompiledChart;
+
+// The size of one element of each section, in bytes.
+static const int sectionElementSize[SectionCount] = {
+    sizeof(qint32),         // StateMachineTableSection
+    sizeof(InstructionId),  // InstructionsSection
+    sizeof(EvaluatorInfo),  // EvaluatorsSection
+    sizeof(AssignmentInfo), // AssignmentsSection
+    sizeof(ForeachInfo),    // ForeachesSection
+    sizeof(StringId),       // DataNamesSection
+    sizeof(StringId),       // StateNamesSection
+    2 * sizeof(qint32),     // StringsSection
+    sizeof(char16_t),       // StringDataSection
+    sizeof(qint32)          // FactoriesSection
+};
+
+static void collectAllDocuments(DocumentModel::ScxmlDocument *doc,
+                                QList<DocumentModel::ScxmlDocument *> *docs)
+{
+    docs->append(doc);
+    for (DocumentModel::ScxmlDocument *subDoc : std::as_const(doc->allSubDocuments))
+        collectAllDocuments(subDoc, docs);
+}
+
+bool CompiledChartWriter::addDocument(DocumentModel::ScxmlDocument *mainDoc, QString *error)
+{
+    QList<DocumentModel::ScxmlDocument *> docs;
+    collectAllDocuments(mainDoc, &docs);
+
+    for (DocumentModel::ScxmlDocument *doc : std::as_const(docs)) {
+        if (doc->root->dataModel == DocumentModel::Scxml::CppDataModel) {
+            *error = QStringLiteral("compiled charts cannot use the C++ data model");
+            return false;
+        }
+    }
+
+    // The documents don't depend on each other, so their tables are built concurrently. Each job
+    // only writes to the entries for its own document.
+    const qsizetype firstChart = m_charts.size();
+    QList<GeneratedTableData> tables(docs.size());
+    QList<GeneratedTableData::MetaDataInfo> metaDataInfos(docs.size());
+    QList<QList<FactoryInfo>> factories(docs.size());
+    GeneratedTableData *tableData = tables.data();
+    GeneratedTableData::MetaDataInfo *metaDataInfoData = metaDataInfos.data();
+    QList<FactoryInfo> *factoryData = factories.data();
+    auto buildTable = [&](int i) {
+        GeneratedTableData::DataModelInfo dataModelInfo;
+        QList<FactoryInfo> *chartFactories = &factoryData[i];
+        GeneratedTableData::build(docs.at(i), &tableData[i], &metaDataInfoData[i], &dataModelInfo,
+                                  [&docs, chartFactories, firstChart](
+                const InvokeInfo &invokeInfo, const QList<StringId> &names,
+                const QList<ParameterInfo> &parameters,
+                const QSharedPointer<DocumentModel::ScxmlDocument> &content) -> int {
+            FactoryInfo factory;
+            factory.invokeInfo = invokeInfo;
+            factory.names = names;
+            factory.parameters = parameters;
+            if (invokeInfo.expr == NoEvaluator)
+                factory.childChart = int(firstChart + docs.indexOf(content.data()));
+            chartFactories->append(factory);
+            return int(chartFactories->size()) - 1;
+        });
+        if (m_precomputeTransitions)
+            GeneratedTableData::precomputeTransitionPaths(&tableData[i]);
+    };
+
+    if (docs.size() == 1) {
+        buildTable(0);
+    } else {
+        QThreadPool pool;
+        for (int i = 0, ei = int(docs.size()); i != ei; ++i)
+            pool.start([&buildTable, i]() { buildTable(i); });
+        pool.waitForDone();
+    }
+
+    for (qsizetype i = 0, ei = docs.size(); i != ei; ++i)
+        addChart(tables.at(i), metaDataInfos.at(i).stateNames, factories.at(i));
+    return true;
+}
+
+void CompiledChartWriter::addChart(const GeneratedTableData &table, const QStringList &stateNames,
+                                   const QList<FactoryInfo> &factories)
+{
+    QStringList strings = table.theStrings;
+    QList<qint32> stateNameIds;
+    stateNameIds.reserve(stateNames.size());
+    for (const QString &stateName : stateNames) {
+        qsizetype id = strings.indexOf(stateName);
+        if (id == -1) {
+            id = strings.size();
+            strings.append(stateName);
+        }
+        stateNameIds.append(qint32(id));
+    }
+
+    QList<qint32> stringInfos;
+    QString stringData;
+    stringInfos.reserve(2 * strings.size());
+    for (const QString &string : std::as_const(strings)) {
+        stringInfos.append(qint32(stringData.size()));
+        stringInfos.append(qint32(string.size()));
+        stringData.append(string);
+    }
+
+    QList<qint32> factoryData;
+    for (const FactoryInfo &factory : factories) {
+        const InvokeInfo &invokeInfo = factory.invokeInfo;
+        factoryData << invokeInfo.id << invokeInfo.prefix << invokeInfo.location
+                    << invokeInfo.context << invokeInfo.expr << invokeInfo.finalize
+                    << qint32(invokeInfo.autoforward) << factory.childChart;
+        factoryData << qint32(factory.names.size());
+        factoryData.append(factory.names);
+        factoryData << qint32(factory.parameters.size());
+        for (const ParameterInfo &parameter : factory.parameters)
+            factoryData << parameter.name << parameter.expr << parameter.location;
+    }
+
+    ChartHeader header;
+    header.name = table.theName;
+    header.initialSetup = table.theInitialSetup;
+
+    QByteArray chart(sizeof(ChartHeader), '\0');
+    auto addSection = [&](Section section, const void *data, qsizetype count) {
+        header.sections[section].offset = qint32(chart.size());
+        header.sections[section].count = qint32(count);
+        chart.append(static_cast<const char *>(data), count * sectionElementSize[section]);
+        while (chart.size() % sizeof(qint32))
+            chart.append('\0');
+    };
+
+    addSection(StateMachineTableSection, table.theStateMachineTable.constData(),
+               table.theStateMachineTable.size());
+    addSection(InstructionsSection, table.theInstructions.constData(),
+               table.theInstructions.size());
+    addSection(EvaluatorsSection, table.theEvaluators.constData(), table.theEvaluators.size());
+    addSection(AssignmentsSection, table.theAssignments.constData(), table.theAssignments.size());
+    addSection(ForeachesSection, table.theForeaches.constData(), table.theForeaches.size());
+    addSection(DataNamesSection, table.theDataNameIds.constData(), table.theDataNameIds.size());
+    addSection(StateNamesSection, stateNameIds.constData(), stateNameIds.size());
+    addSection(StringsSection, stringInfos.constData(), strings.size());
+    addSection(StringDataSection, stringData.constData(), stringData.size());
+    addSection(FactoriesSection, factoryData.constData(), factoryData.size());
+
+    memcpy(chart.data(), &header, sizeof(ChartHeader));
+    m_charts.append(chart);
+}
+
+QByteArray CompiledChartWriter::data() const
+{
+    const FileHeader header = {
+        Magic, FormatVersion, Q_QSCXMLC_OUTPUT_REVISION, qint32(m_charts.size())
+    };
+
+    QByteArray data(reinterpret_cast<const char *>(&header), sizeof(FileHeader));
+    qint32 offset = qint32(sizeof(FileHeader) + m_charts.size() * sizeof(qint32));
+    for (const QByteArray &chart : m_charts) {
+        data.append(reinterpret_cast<const char *>(&offset), sizeof(qint32));
+        offset += qint32(chart.size());
+    }
+    for (const QByteArray &chart : m_charts)
+        data.append(chart);
+    return data;
+}
+
+#ifndef BUILD_QSCXMLC
+namespace {
+struct CompiledChartRegistry
+{
+    QMutex mutex;
+    QHash<QString, QWeakPointer<CompiledChartFile>> files;
+};
+}
+
+Q_GLOBAL_STATIC(CompiledChartRegistry, compiledChartRegistry)
+
+// Reads one factory record at data[*pos], and advances *pos past it.
+static bool readFactory(const qint32 *data, int count, int *pos, FactoryInfo *factory)
+{
+    const int fixedCount = 9; // the invoke info, the child chart, and the number of names
+    if (count - *pos < fixedCount)
+        return false;
+
+    const qint32 *record = data + *pos;
+    factory->invokeInfo.id = record[0];
+    factory->invokeInfo.prefix = record[1];
+    factory->invokeInfo.location = record[2];
+    factory->invokeInfo.context = record[3];
+    factory->invokeInfo.expr = record[4];
+    factory->invokeInfo.finalize = record[5];
+    factory->invokeInfo.autoforward = record[6] != 0;
+    factory->childChart = record[7];
+    const int nameCount = record[8];
+    *pos += fixedCount;
+
+    if (nameCount < 0 || count - *pos < nameCount + 1)
+        return false;
+    factory->names = QList<StringId>(data + *pos, data + *pos + nameCount);
+    *pos += nameCount;
+
+    const int parameterCount = data[(*pos)++];
+    if (parameterCount < 0 || (count - *pos) / 3 < parameterCount)
+        return false;
+    factory->parameters.clear();
+    factory->parameters.reserve(parameterCount);
+    for (int i = 0; i < parameterCount; ++i, *pos += 3)
+        factory->parameters.append({ data[*pos], data[*pos + 1], data[*pos + 2] });
+    return true;
+}
+
+namespace {
+template <typename T>
+constexpr qint64 wordCount() { return qint64(sizeof(T) / sizeof(qint32)); }
+
+// Checks that every index in a chart refers to something inside it, or is the invalid index where
+// the field is optional: the state machine and the execution engine follow them without checking.
+// This does not check that the chart describes a sensible state machine.
+class ChartValidator
+{
+public:
+    ChartValidator(const CompiledChartFile *file, int chart)
+    {
+        m_table = file->section(chart, StateMachineTableSection, &m_tableSize);
+        m_instructions = file->section(chart, InstructionsSection, &m_instructionCount);
+        m_evaluators = reinterpret_cast<const EvaluatorInfo *>(
+                    file->section(chart, EvaluatorsSection, &m_evaluatorCount));
+        m_assignments = reinterpret_cast<const AssignmentInfo *>(
+                    file->section(chart, AssignmentsSection, &m_assignmentCount));
+        m_foreaches = reinterpret_cast<const ForeachInfo *>(
+                    file->section(chart, ForeachesSection, &m_foreachCount));
+        m_dataNames = file->section(chart, DataNamesSection, &m_dataNameCount);
+        file->section(chart, StringsSection, &m_stringCount);
+        m_header = file->chart(chart);
+    }
+
+    bool validate(const QList<FactoryInfo> &factories) const
+    {
+        return validateInfos() && validateTable(factories) && validateStates()
+                && validateTransitions() && validateTransitionPaths()
+                && validateFactories(factories);
+    }
+
+private:
+    enum { MaxNesting = 1024 };
+
+    const StateTable *table() const { return reinterpret_cast<const StateTable *>(m_table); }
+
+    bool isString(StringId id) const
+    { return id == NoString || (id >= 0 && id < m_stringCount); }
+    bool isEvaluator(EvaluatorId id) const { return id >= 0 && id < m_evaluatorCount; }
+    bool isOptionalEvaluator(EvaluatorId id) const
+    { return id == NoEvaluator || isEvaluator(id); }
+    bool isState(int index) const { return index >= 0 && index < table()->stateCount; }
+    bool isOptionalState(int index) const
+    { return index == StateTable::InvalidIndex || isState(index); }
+    bool isTransition(int index) const { return index >= 0 && index < table()->transitionCount; }
+    bool isOptionalTransition(int index) const
+    { return index == StateTable::InvalidIndex || isTransition(index); }
+
+    bool isArray(int index) const
+    {
+        if (index < 0 || index >= table()->arraySize)
+            return false;
+        const int size = m_table[table()->arrayOffset + index];
+        return size >= 0 && table()->arraySize - index - 1 >= size;
+    }
+
+    template <typename IsElement>
+    bool isOptionalArray(int index, IsElement isElement) const
+    {
+        if (index == StateTable::InvalidIndex)
+            return true;
+        if (!isArray(index))
+            return false;
+        for (int element : table()->array(index)) {
+            if (!isElement(element))
+                return false;
+        }
+        return true;
+    }
+
+    bool validateInfos() const
+    {
+        for (int i = 0; i < m_evaluatorCount; ++i) {
+            const EvaluatorInfo &info = m_evaluators[i];
+            if (!isString(info.expr) || !isString(info.context))
+                return false;
+        }
+        for (int i = 0; i < m_assignmentCount; ++i) {
+            const AssignmentInfo &info = m_assignments[i];
+            if (!isString(info.dest) || !isString(info.expr) || !isString(info.context))
+                return false;
+        }
+        for (int i = 0; i < m_foreachCount; ++i) {
+            const ForeachInfo &info = m_foreaches[i];
+            if (!isString(info.array) || !isString(info.item) || !isString(info.index)
+                    || !isString(info.context)) {
+                return false;
+            }
+        }
+        for (int i = 0; i < m_dataNameCount; ++i) {
+            if (m_dataNames[i] < 0 || m_dataNames[i] >= m_stringCount)
+                return false;
+        }
+        return isString(m_header->name) && validateContainer(m_header->initialSetup);
+    }
+
+    bool validateTable(const QList<FactoryInfo> &factories) const
+    {
+        const StateTable *t = table();
+        auto fits = [this](int offset, int count, qint64 elementSize) {
+            return offset >= 0 && count >= 0
+                    && qint64(offset) + count * elementSize <= m_tableSize;
+        };
+        if (!fits(t->stateOffset, t->stateCount, wordCount<StateTable::State>())
+                || !fits(t->transitionOffset, t->transitionCount,
+                         wordCount<StateTable::Transition>())
+                || !fits(t->arrayOffset, t->arraySize, 1)) {
+            return false;
+        }
+        if (t->maxServiceId < StateTable::InvalidIndex || t->maxServiceId >= factories.size())
+            return false;
+        return isString(t->name) && isString(t->ecmaScriptModule)
+                && isOptionalArray(t->childStates, [this](int s) { return isState(s); })
+                && isOptionalTransition(t->initialTransition)
+                && validateContainer(t->initialSetup);
+    }
+
+    bool validateStates() const
+    {
+        const int maxServiceId = table()->maxServiceId;
+        for (int i = 0; i < table()->stateCount; ++i) {
+            const StateTable::State &state = table()->state(i);
+            // Parents come before their children, which also rules out cycles.
+            if (!isString(state.name) || state.parent < StateTable::InvalidIndex
+                    || state.parent >= i) {
+                return false;
+            }
+            if (state.type < StateTable::State::Normal
+                    || state.type > StateTable::State::DeepHistory
+                    || (state.isHistoryState() && state.parentIsScxmlElement())) {
+                return false;
+            }
+            if (!isOptionalTransition(state.initialTransition)
+                    || !validateContainer(state.initInstructions)
+                    || !validateContainer(state.entryInstructions)
+                    || !validateContainer(state.exitInstructions)
+                    || !validateContainer(state.doneData)) {
+                return false;
+            }
+            if (!isOptionalArray(state.childStates, [this](int s) { return isState(s); })
+                    || !isOptionalArray(state.transitions,
+                                        [this](int t) { return isTransition(t); })
+                    || !isOptionalArray(state.serviceFactoryIds,
+                                        [maxServiceId](int id) {
+                                            return id >= 0 && id <= maxServiceId;
+                                        })) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    bool validateTransitions() const
+    {
+        for (int i = 0; i < table()->transitionCount; ++i) {
+            const StateTable::Transition &transition = table()->transition(i);
+            if (transition.type < StateTable::Transition::Internal
+                    || transition.type > StateTable::Transition::Synthetic) {
+                return false;
+            }
+            if (!isOptionalArray(transition.events,
+                                 [this](int id) { return id >= 0 && id < m_stringCount; })
+                    || !isOptionalEvaluator(transition.condition)
+                    || !isOptionalState(transition.source)
+                    || !isOptionalArray(transition.targets, [this](int s) { return isState(s); })
+                    || !validateContainer(transition.transitionInstructions)) {
+                return false;
+            }
+        }
+
+        // Initial transitions and the ones of history states are taken without checking that
+        // they have targets.
+        auto hasTargets = [this](int t) {
+            return t == StateTable::InvalidIndex
+                    || table()->transition(t).targets != StateTable::InvalidIndex;
+        };
+        if (!hasTargets(table()->initialTransition))
+            return false;
+        for (int i = 0; i < table()->stateCount; ++i) {
+            const StateTable::State &state = table()->state(i);
+            if (!hasTargets(state.initialTransition))
+                return false;
+            if (state.isHistoryState() && state.transitions != StateTable::InvalidIndex) {
+                const StateTable::Array transitions = table()->array(state.transitions);
+                if (transitions.size() == 0 || !hasTargets(transitions[0]))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    bool validateTransitionPaths() const
+    {
+        const int transitionPaths = table()->transitionPaths;
+        if (transitionPaths == StateTable::InvalidIndex)
+            return true;
+        if (!isArray(transitionPaths)
+                || table()->array(transitionPaths).size() != table()->transitionCount) {
+            return false;
+        }
+        for (int pathIndex : table()->array(transitionPaths)) {
+            if (pathIndex == StateTable::InvalidIndex)
+                continue;
+            if (!isArray(pathIndex))
+                return false;
+            const StateTable::Array path = table()->array(pathIndex);
+            if (path.size() < StateTable::PathEntries
+                    || (path.size() - StateTable::PathEntries) % 2 != 0
+                    || !isOptionalState(path[StateTable::PathDomain])
+                    || !isOptionalState(path[StateTable::PathLastDescendant])) {
+                return false;
+            }
+            for (int i = StateTable::PathEntries; i < path.size(); i += 2) {
+                if (!isState(path[i]) || !validateContainer(path[i + 1]))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    bool validateFactories(const QList<FactoryInfo> &factories) const
+    {
+        for (const FactoryInfo &factory : factories) {
+            const InvokeInfo &info = factory.invokeInfo;
+            if (!isString(info.id) || !isString(info.prefix) || !isString(info.location)
+                    || !isString(info.context) || !isOptionalEvaluator(info.expr)
+                    || !validateContainer(info.finalize)) {
+                return false;
+            }
+            for (StringId name : factory.names) {
+                if (!isString(name))
+                    return false;
+            }
+            for (const ParameterInfo &parameter : factory.parameters) {
+                if (!validateParameter(parameter))
+                    return false;
+            }
+        }
+        return true;
+    }
+
+    bool validateParameter(const ParameterInfo &parameter) const
+    {
+        return isString(parameter.name) && isOptionalEvaluator(parameter.expr)
+                && isString(parameter.location);
+    }
+
+    bool validateParameters(const Array<ParameterInfo> *parameters, qint64 available) const
+    {
+        if (available < 1 || parameters->count < 0
+                || (available - 1) / wordCount<ParameterInfo>() < parameters->count) {
+            return false;
+        }
+        for (int i = 0; i < parameters->count; ++i) {
+            if (!validateParameter(parameters->at(i)))
+                return false;
+        }
+        return true;
+    }
+
+    bool validateContainer(ContainerId id) const
+    {
+        qint64 next = 0;
+        return id == NoContainer || validateInstruction(id, m_instructionCount, 0, &next);
+    }
+
+    bool isSequence(qint64 pos, qint64 end) const
+    {
+        return pos >= 0 && pos < end
+                && reinterpret_cast<const Instruction *>(m_instructions + pos)->instructionType
+                    == Instruction::Sequence;
+    }
+
+    // Checks the instruction at pos, which has to end before end, and sets *next to the position
+    // right after it.
+    bool validateInstruction(qint64 pos, qint64 end, int depth, qint64 *next) const
+    {
+        if (pos < 0 || pos >= end || depth > MaxNesting)
+            return false;
+
+        const InstructionId *ip = m_instructions + pos;
+        const qint64 available = end - pos;
+        switch (reinterpret_cast<const Instruction *>(ip)->instructionType) {
+        case Instruction::Sequence: {
+            const auto *sequence = reinterpret_cast<const InstructionSequence *>(ip);
+            const qint64 start = pos + wordCount<InstructionSequence>();
+            if (available < wordCount<InstructionSequence>() || sequence->entryCount < 0
+                    || end - start < sequence->entryCount) {
+                return false;
+            }
+            *next = start + sequence->entryCount;
+            for (qint64 sub = start; sub < *next;) {
+                if (!validateInstruction(sub, *next, depth + 1, &sub))
+                    return false;
+            }
+            return true;
+        }
+        case Instruction::Sequences: {
+            const auto *sequences = reinterpret_cast<const InstructionSequences *>(ip);
+            const qint64 start = pos + wordCount<InstructionSequences>();
+            if (available < wordCount<InstructionSequences>() || sequences->sequenceCount < 0
+                    || sequences->entryCount < 0 || end - start < sequences->entryCount) {
+                return false;
+            }
+            *next = start + sequences->entryCount;
+            qint64 sub = start;
+            for (int i = 0; i < sequences->sequenceCount; ++i) {
+                if (!isSequence(sub, *next) || !validateInstruction(sub, *next, depth + 1, &sub))
+                    return false;
+            }
+            return true;
+        }
+        case Instruction::Send: {
+            const auto *send = reinterpret_cast<const Send *>(ip);
+            if (available < wordCount<Send>() || send->namelist.count < 0
+                    || available - wordCount<Send>() < send->namelist.count) {
+                return false;
+            }
+            if (!isString(send->instructionLocation) || !isString(send->event)
+                    || !isOptionalEvaluator(send->eventexpr) || !isString(send->type)
+                    || !isOptionalEvaluator(send->typeexpr) || !isString(send->target)
+                    || !isOptionalEvaluator(send->targetexpr) || !isString(send->id)
+                    || !isString(send->idLocation) || !isString(send->delay)
+                    || !isOptionalEvaluator(send->delayexpr) || !isString(send->content)
+                    || !isOptionalEvaluator(send->contentexpr)) {
+                return false;
+            }
+            for (int i = 0; i < send->namelist.count; ++i) {
+                if (!isString(send->namelist.at(i)))
+                    return false;
+            }
+            if (!validateParameters(send->params(), available - send->paramsOffset()))
+                return false;
+            *next = pos + send->size();
+            return true;
+        }
+        case Instruction::Raise: {
+            const auto *raise = reinterpret_cast<const Raise *>(ip);
+            if (available < raise->size() || !isString(raise->event))
+                return false;
+            *next = pos + raise->size();
+            return true;
+        }
+        case Instruction::Log: {
+            const auto *log = reinterpret_cast<const Log *>(ip);
+            if (available < log->size() || !isString(log->label)
+                    || !isOptionalEvaluator(log->expr)) {
+                return false;
+            }
+            *next = pos + log->size();
+            return true;
+        }
+        case Instruction::JavaScript: {
+            const auto *javascript = reinterpret_cast<const JavaScript *>(ip);
+            if (available < javascript->size() || !isEvaluator(javascript->go))
+                return false;
+            *next = pos + javascript->size();
+            return true;
+        }
+        case Instruction::Assign: {
+            const auto *assign = reinterpret_cast<const Assign *>(ip);
+            if (available < assign->size() || assign->expression < 0
+                    || assign->expression >= m_assignmentCount) {
+                return false;
+            }
+            *next = pos + assign->size();
+            return true;
+        }
+        case Instruction::Initialize: {
+            const auto *init = reinterpret_cast<const Initialize *>(ip);
+            if (available < init->size() || init->expression < 0
+                    || init->expression >= m_assignmentCount) {
+                return false;
+            }
+            *next = pos + init->size();
+            return true;
+        }
+        case Instruction::If: {
+            const auto *_if = reinterpret_cast<const If *>(ip);
+            if (available < wordCount<If>() || _if->conditions.count < 0
+                    || available - wordCount<If>() < _if->conditions.count) {
+                return false;
+            }
+            for (int i = 0; i < _if->conditions.count; ++i) {
+                if (!isEvaluator(_if->conditions.at(i)))
+                    return false;
+            }
+            const qint64 blocks = pos + wordCount<If>() + _if->conditions.count;
+            if (blocks >= end || _if->blocks()->instructionType != Instruction::Sequences
+                    || !validateInstruction(blocks, end, depth + 1, next)) {
+                return false;
+            }
+            return _if->blocks()->sequenceCount >= _if->conditions.count;
+        }
+        case Instruction::Foreach: {
+            const auto *_foreach = reinterpret_cast<const Foreach *>(ip);
+            if (available < wordCount<Foreach>() || _foreach->doIt < 0
+                    || _foreach->doIt >= m_foreachCount) {
+                return false;
+            }
+            const qint64 block = pos + (_foreach->blockstart() - ip);
+            return isSequence(block, end) && validateInstruction(block, end, depth + 1, next);
+        }
+        case Instruction::Cancel: {
+            const auto *cancel = reinterpret_cast<const Cancel *>(ip);
+            if (available < cancel->size() || !isString(cancel->sendid)
+                    || !isOptionalEvaluator(cancel->sendidexpr)) {
+                return false;
+            }
+            *next = pos + cancel->size();
+            return true;
+        }
+        case Instruction::DoneData: {
+            // The execution engine does not step over done data, so it cannot be nested.
+            const auto *doneData = reinterpret_cast<const DoneData *>(ip);
+            if (depth != 0 || available < wordCount<DoneData>() || !isString(doneData->location)
+                    || !isString(doneData->contents) || !isOptionalEvaluator(doneData->expr)) {
+                return false;
+            }
+            const qint64 params = wordCount<DoneData>() - wordCount<Array<ParameterInfo>>();
+            if (!validateParameters(&doneData->params, available - params))
+                return false;
+            *next = pos + params + doneData->params.size();
+            return true;
+        }
+        default:
+            return false;
+        }
+    }
+
+    const qint32 *m_table = nullptr;
+    const InstructionId *m_instructions = nullptr;
+    const EvaluatorInfo *m_evaluators = nullptr;
+    const AssignmentInfo *m_assignments = nullptr;
+    const ForeachInfo *m_foreaches = nullptr;
+    const StringId *m_dataNames = nullptr;
+    const ChartHeader *m_header = nullptr;
+    int m_tableSize = 0;
+    int m_instructionCount = 0;
+    int m_evaluatorCount = 0;
+    int m_assignmentCount = 0;
+    int m_foreachCount = 0;
+    int m_dataNameCount = 0;
+    int m_stringCount = 0;
+};
+} // anonymous namespace
+
+CompiledChartFile::~CompiledChartFile()
+{
+    delete m_file;
+}
+
+QSharedPointer<CompiledChartFile> CompiledChartFile::open(const QString &fileName, QString *error)
+{
+    const QFileInfo info(fileName);
+    const QString key = QStringLiteral("%1:%2:%3").arg(
+                info.canonicalFilePath(), QString::number(info.size()),
+                QString::number(info.lastModified().toMSecsSinceEpoch()));
+
+    CompiledChartRegistry *registry = compiledChartRegistry();
+    QMutexLocker locker(&registry->mutex);
+    if (auto file = registry->files.value(key).toStrongRef())
+        return file;
+
+    QSharedPointer<CompiledChartFile> file(new CompiledChartFile);
+    file->m_file = new QFile(fileName);
+    if (!file->m_file->open(QIODevice::ReadOnly)) {
+        *error = QStringLiteral("cannot open for reading");
+        return {};
+    }
+
+    file->m_size = file->m_file->size();
+    file->m_data = file->m_file->map(0, file->m_size, QFileDevice::MapPrivateOption);
+    if (!file->m_data) {
+        *error = QStringLiteral("cannot map: %1").arg(file->m_file->errorString());
+        return {};
+    }
+
+    if (!file->validate(error))
+        return {};
+
+    for (auto it = registry->files.begin(); it != registry->files.end();) {
+        if (it.value().isNull())
+            it = registry->files.erase(it);
+        else
+            ++it;
+    }
+    registry->files.insert(key, file);
+    return file;
+}
+
+bool CompiledChartFile::validate(QString *error) const
+{
+    if (m_size < qint64(sizeof(FileHeader))) {
+        *error = QStringLiteral("not a compiled chart");
+        return false;
+    }
+
+    const FileHeader *header = reinterpret_cast<const FileHeader *>(m_data);
+    if (header->magic != Magic) {
+        *error = QStringLiteral("not a compiled chart");
+        return false;
+    }
+    if (header->formatVersion != FormatVersion
+            || header->outputRevision != Q_QSCXMLC_OUTPUT_REVISION) {
+        *error = QStringLiteral("compiled chart has an incompatible version");
+        return false;
+    }
+    if (header->chartCount <= 0
+            || (m_size - qint64(sizeof(FileHeader))) / qint64(sizeof(qint32))
+                < header->chartCount) {
+        *error = QStringLiteral("compiled chart is corrupt");
+        return false;
+    }
+
+    for (int i = 0; i < header->chartCount; ++i) {
+        if (!validateChart(i, error))
+            return false;
+    }
+    return true;
+}
+
+// Checks that all sections and the references between them stay inside the file, so that the
+// accessors below and the state machine can use them without checking them again.
+bool CompiledChartFile::validateChart(int index, QString *error) const
+{
+    *error = QStringLiteral("compiled chart is corrupt");
+
+    const qint32 chartOffset = reinterpret_cast<const qint32 *>(
+                m_data + sizeof(FileHeader))[index];
+    if (chartOffset < 0 || chartOffset % qint32(sizeof(qint32)) != 0
+            || m_size - chartOffset < qint64(sizeof(ChartHeader))) {
+        return false;
+    }
+
+    const ChartHeader *header = chart(index);
+    for (int i = 0; i < SectionCount; ++i) {
+        const SectionInfo &section = header->sections[i];
+        if (section.offset < qint32(sizeof(ChartHeader))
+                || section.offset % qint32(sizeof(qint32)) != 0 || section.count < 0) {
+            return false;
+        }
+        const qint64 end = qint64(chartOffset) + section.offset
+                + qint64(section.count) * sectionElementSize[i];
+        if (end > m_size)
+            return false;
+    }
+
+    int count = 0;
+    const qint32 *table = section(index, StateMachineTableSection, &count);
+    if (count < int(sizeof(StateTable) / sizeof(qint32)))
+        return false;
+    const StateTable *stateTable = reinterpret_cast<const StateTable *>(table);
+    if (stateTable->version != Q_QSCXMLC_OUTPUT_REVISION) {
+        *error = QStringLiteral("compiled chart has an incompatible version");
+        return false;
+    }
+    if (stateTable->dataModel != StateTable::NullDataModel
+            && stateTable->dataModel != StateTable::EcmaScriptDataModel) {
+        *error = QStringLiteral("compiled charts only support the null and the ECMAScript "
+                                "data models");
+        return false;
+    }
+
+    int stringDataCount = 0;
+    section(index, StringDataSection, &stringDataCount);
+    int stringCount = 0;
+    const qint32 *strings = section(index, StringsSection, &stringCount);
+    for (int i = 0; i < stringCount; ++i) {
+        const qint32 offset = strings[2 * i];
+        const qint32 length = strings[2 * i + 1];
+        if (offset < 0 || length < 0 || stringDataCount - offset < length)
+            return false;
+    }
+
+    int stateNameCount = 0;
+    const qint32 *stateNames = section(index, StateNamesSection, &stateNameCount);
+    for (int i = 0; i < stateNameCount; ++i) {
+        if (stateNames[i] < 0 || stateNames[i] >= stringCount)
+            return false;
+    }
+
+    int factoryDataCount = 0;
+    const qint32 *factoryData = section(index, FactoriesSection, &factoryDataCount);
+    QList<FactoryInfo> factories;
+    FactoryInfo factory;
+    for (int pos = 0; pos < factoryDataCount;) {
+        if (!readFactory(factoryData, factoryDataCount, &pos, &factory))
+            return false;
+        if (factory.childChart < -1 || factory.childChart >= chartCount())
+            return false;
+        factories.append(factory);
+    }
+
+    if (!ChartValidator(this, index).validate(factories))
+        return false;
+
+    error->clear();
+    return true;
+}
+
+int CompiledChartFile::chartCount() const
+{
+    return reinterpret_cast<const FileHeader *>(m_data)->chartCount;
+}
+
+const ChartHeader *CompiledChartFile::chart(int index) const
+{
+    Q_ASSERT(index >= 0 && index < chartCount());
+    const qint32 offset = reinterpret_cast<const qint32 *>(m_data + sizeof(FileHeader))[index];
+    return reinterpret_cast<const ChartHeader *>(m_data + offset);
+}
+
+const qint32 *CompiledChartFile::section(int chartIndex, Section section, int *count) const
+{
+    const ChartHeader *header = chart(chartIndex);
+    *count = header->sections[section].count;
+    return reinterpret_cast<const qint32 *>(reinterpret_cast<const uchar *>(header)
+                                            + header->sections[section].offset);
+}
+
+QString CompiledChartFile::string(int chartIndex, StringId id) const
+{
+    if (id == NoString)
+        return QString();
+
+    int count = 0;
+    const qint32 *strings = section(chartIndex, StringsSection, &count);
+    Q_ASSERT(id >= 0 && id < count);
+    const char16_t *stringData = reinterpret_cast<const char16_t *>(
+                section(chartIndex, StringDataSection, &count));
+    return QString(reinterpret_cast<const QChar *>(stringData + strings[2 * id]),
+                   strings[2 * id + 1]);
+}
+
+QStringList CompiledChartFile::stateNames(int chartIndex) const
+{
+    int count = 0;
+    const qint32 *ids = section(chartIndex, StateNamesSection, &count);
+    QStringList names;
+    names.reserve(count);
+    for (int i = 0; i < count; ++i)
+        names.append(string(chartIndex, ids[i]));
+    return names;
+}
+
+QList<FactoryInfo> CompiledChartFile::factories(int chartIndex) const
+{
+    int count = 0;
+    const qint32 *data = section(chartIndex, FactoriesSection, &count);
+    QList<FactoryInfo> factories;
+    FactoryInfo factory;
+    for (int pos = 0; pos < count;) {
+        readFactory(data, count, &pos, &factory); // validated when opening the file
+        factories.append(factory);
+    }
+    return factories;
+}
+
+CompiledTableData::CompiledTableData(const QSharedPointer<CompiledChartFile> &file, int chart,
+                                     CreateFactory createFactory)
+    : m_file(file)
+    , m_chart(chart)
+    , m_factoryInfos(file->factories(chart))
+    , m_createFactory(std::move(createFactory))
+{}
+
+QString CompiledTableData::string(StringId id) const
+{
+    return m_file->string(m_chart, id);
+}
+
+InstructionId *CompiledTableData::instructions() const
+{
+    int count = 0;
+    // The file is mapped privately, so nothing ever gets written back to it.
+    return const_cast<InstructionId *>(m_file->section(m_chart, InstructionsSection, &count));
+}
+
+EvaluatorInfo CompiledTableData::evaluatorInfo(EvaluatorId evaluatorId) const
+{
+    int count = 0;
+    const qint32 *evaluators = m_file->section(m_chart, EvaluatorsSection, &count);
+    Q_ASSERT(evaluatorId >= 0 && evaluatorId < count);
+    return reinterpret_cast<const EvaluatorInfo *>(evaluators)[evaluatorId];
+}
+
+AssignmentInfo CompiledTableData::assignmentInfo(EvaluatorId assignmentId) const
+{
+    int count = 0;
+    const qint32 *assignments = m_file->section(m_chart, AssignmentsSection, &count);
+    Q_ASSERT(assignmentId >= 0 && assignmentId < count);
+    return reinterpret_cast<const AssignmentInfo *>(assignments)[assignmentId];
+}
+
+ForeachInfo CompiledTableData::foreachInfo(EvaluatorId foreachId) const
+{
+    int count = 0;
+    const qint32 *foreaches = m_file->section(m_chart, ForeachesSection, &count);
+    Q_ASSERT(foreachId >= 0 && foreachId < count);
+    return reinterpret_cast<const ForeachInfo *>(foreaches)[foreachId];
+}
+
+StringId *CompiledTableData::dataNames(int *count) const
+{
+    return const_cast<StringId *>(m_file->section(m_chart, DataNamesSection, count));
+}
+
+ContainerId CompiledTableData::initialSetup() const
+{
+    return m_file->chart(m_chart)->initialSetup;
+}
+
+QString CompiledTableData::name() const
+{
+    return string(m_file->chart(m_chart)->name);
+}
+
+const qint32 *CompiledTableData::stateMachineTable() const
+{
+    int count = 0;
+    return m_file->section(m_chart, StateMachineTableSection, &count);
+}
+
+QScxmlInvokableServiceFactory *CompiledTableData::serviceFactory(int id) const
+{
+    return m_createFactory(m_factoryInfos.at(id));
+}
+#endif // BUILD_QSCXMLC
+
+} // QScxmlInternal namespace
+
+QT_END_NAMESPACE
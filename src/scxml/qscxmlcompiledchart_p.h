@@ -0,0 +1,172 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#ifndef QSCXMLCOMPILEDCHART_P_H
+#define QSCXMLCOMPILEDCHART_P_H
+
+//
+//  W A R N I N G
+//  -------------
+//
+// This file is not part of the Qt API.  It exists purely as an
+// implementation detail.  This header file may change from version to
+// version without notice, or even be removed.
+//
+// We mean it.
+//
+
+#include <QtScxml/private/qscxmltabledata_p.h>
+#include <QtCore/qbytearray.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qsharedpointer.h>
+#include <QtCore/qstringlist.h>
+
+#include <functional>
+
+QT_BEGIN_NAMESPACE
+class QFile;
+class QScxmlStateMachine;
+
+namespace QScxmlInternal {
+
+// A compiled chart file holds the tables of a state machine and of all state machines that it
+// invokes through <content>, in a form that can be used straight from a memory mapped file.
+// Everything is stored as qint32 in host byte order, and all offsets are in bytes, relative to
+// the start of the chart they belong to. Files written on a machine with a different byte order
+// are rejected because the magic does not match.
+namespace CompiledChart {
+
+enum : quint32 { Magic = 0x42435351 }; // "QSCB" when read as little endian
+enum : qint32 { FormatVersion = 1 };
+
+enum Section {
+    StateMachineTableSection,
+    InstructionsSection,
+    EvaluatorsSection,
+    AssignmentsSection,
+    ForeachesSection,
+    DataNamesSection,
+    StateNamesSection,      // string ids
+    StringsSection,         // offset into the string data and length, both in UTF-16 code units
+    StringDataSection,      // UTF-16, the count is in code units
+    FactoriesSection,       // variable sized records, the count is in qint32 words
+    SectionCount
+};
+
+struct FileHeader {
+    quint32 magic;
+    qint32 formatVersion;
+    qint32 outputRevision;
+    qint32 chartCount;
+    // followed by qint32 chartOffsets[chartCount], in bytes from the start of the file
+};
+
+struct SectionInfo {
+    qint32 offset;
+    qint32 count;
+};
+
+struct ChartHeader {
+    qint32 name;
+    qint32 initialSetup;
+    SectionInfo sections[SectionCount];
+};
+
+struct FactoryInfo {
+    QScxmlExecutableContent::InvokeInfo invokeInfo;
+    QList<QScxmlExecutableContent::StringId> names;
+    QList<QScxmlExecutableContent::ParameterInfo> parameters;
+    int childChart = -1; // the chart for the <content> of the <invoke>, or -1 if it has a srcexpr
+};
+
+} // CompiledChart namespace
+
+class Q_SCXML_EXPORT CompiledChartWriter
+{
+public:
+    // Adds the chart of mainDoc, followed by the charts of all documents it invokes. Returns
+    // false, and adds nothing, if any of them cannot be stored in a compiled chart.
+    bool addDocument(DocumentModel::ScxmlDocument *mainDoc, QString *error);
+    QByteArray data() const;
+
+    // Precompute the paths of the transitions in the charts that are added afterwards.
+    void setPrecomputeTransitions(bool precompute) { m_precomputeTransitions = precompute; }
+
+private:
+    void addChart(const GeneratedTableData &table, const QStringList &stateNames,
+                  const QList<CompiledChart::FactoryInfo> &factories);
+
+    QList<QByteArray> m_charts;
+    bool m_precomputeTransitions = false;
+};
+
+#ifndef BUILD_QSCXMLC
+class Q_SCXML_EXPORT CompiledChartFile
+{
+    Q_DISABLE_COPY(CompiledChartFile)
+public:
+    ~CompiledChartFile();
+
+    // A file is shared by all state machines that are instantiated from it while it is open, and
+    // unmapped when the last of them goes away.
+    static QSharedPointer<CompiledChartFile> open(const QString &fileName, QString *error);
+
+    int chartCount() const;
+    const CompiledChart::ChartHeader *chart(int index) const;
+    const qint32 *section(int chart, CompiledChart::Section section, int *count) const;
+    // Returns a copy, as the strings can outlive the mapping.
+    QString string(int chart, QScxmlExecutableContent::StringId id) const;
+    QStringList stateNames(int chart) const;
+    QList<CompiledChart::FactoryInfo> factories(int chart) const;
+
+private:
+    CompiledChartFile() = default;
+    bool validate(QString *error) const;
+    bool validateChart(int chart, QString *error) const;
+
+    QFile *m_file = nullptr;
+    const uchar *m_data = nullptr;
+    qint64 m_size = 0;
+};
+
+class Q_SCXML_EXPORT CompiledTableData : public QScxmlTableData
+{
+public:
+    typedef std::function<
+        QScxmlInvokableServiceFactory *(const CompiledChart::FactoryInfo &factoryInfo)
+    > CreateFactory;
+
+    CompiledTableData(const QSharedPointer<CompiledChartFile> &file, int chart,
+                      CreateFactory createFactory);
+
+    QString string(QScxmlExecutableContent::StringId id) const override final;
+    QScxmlExecutableContent::InstructionId *instructions() const override final;
+    QScxmlExecutableContent::EvaluatorInfo evaluatorInfo(
+            QScxmlExecutableContent::EvaluatorId evaluatorId) const override final;
+    QScxmlExecutableContent::AssignmentInfo assignmentInfo(
+            QScxmlExecutableContent::EvaluatorId assignmentId) const override final;
+    QScxmlExecutableContent::ForeachInfo foreachInfo(
+            QScxmlExecutableContent::EvaluatorId foreachId) const override final;
+    QScxmlExecutableContent::StringId *dataNames(int *count) const override final;
+    QScxmlExecutableContent::ContainerId initialSetup() const override final;
+    QString name() const override final;
+    const qint32 *stateMachineTable() const override final;
+    QScxmlInvokableServiceFactory *serviceFactory(int id) const override final;
+
+private:
+    QSharedPointer<CompiledChartFile> m_file;
+    int m_chart;
+    QList<CompiledChart::FactoryInfo> m_factoryInfos;
+    CreateFactory m_createFactory;
+};
+
+// Defined in qscxmlcompiler.cpp, next to the other dynamically created state machines.
+QScxmlStateMachine *instantiateCompiledChart(const QSharedPointer<CompiledChartFile> &file,
+                                             int chart);
+#endif // BUILD_QSCXMLC
+
+} // QScxmlInternal namespace
+
+QT_END_NAMESPACE
+
+#endif // QSCXMLCOMPILEDCHART_P_H
@@ -11,6 +11,7 @@
 #include <qstring.h>
 
 #ifndef BUILD_QSCXMLC
+#include "qscxmlcompiledchart_p.h"
 #include "qscxmlinvokableservice_p.h"
 #include "qscxmldatamodel_p.h"
 #include "qscxmlstatemachine_p.h"
@@ -18,10 +19,14 @@
 #include "qscxmltabledata_p.h"
 
 #include <private/qmetaobjectbuilder_p.h>
-#endif // BUILD_QSCXMLC
 
-#include <QtCore/qmap.h>
+#include <QtCore/qcache.h>
+#include <QtCore/qcryptographichash.h>
+#include <QtCore/qmutex.h>
+#endif // BUILD_QSCXMLC
 
+#include <algorithm>
+#include <cmath>
 #include <functional>
 
 namespace {
@@ -217,6 +222,21 @@ private:
         return false;
     }
 
+    void visit(DocumentModel::DataElement *data) override
+    {
+        if (data->type.isEmpty())
+            return;
+
+        if (m_doc->root->dataModel != DocumentModel::Scxml::CppDataModel) {
+            error(data->xmlLocation,
+                  QStringLiteral("qt:type on <data> is only supported by the C++ data model"));
+        } else if (!isValidCppIdentifier(data->id)) {
+            error(data->xmlLocation,
+                  QStringLiteral("'%1' is not a valid C++ identifier, required for typed data")
+                  .arg(data->id));
+        }
+    }
+
     bool visit(DocumentModel::Send *node) override
     {
         checkEvent(node->event, node->xmlLocation, ForbidWildCards);
@@ -278,6 +298,17 @@ private:
         return true;
     }
 
+    static bool isValidCppIdentifier(const QString &id)
+    {
+        if (id.isEmpty() || id.at(0).isDigit())
+            return false;
+        for (QChar c : id) {
+            if (c.unicode() > 127 || !(c.isLetterOrNumber() || c == QLatin1Char('_')))
+                return false;
+        }
+        return true;
+    }
+
     static bool isLetter(QChar c)
     {
         switch (c.category()) {
@@ -429,7 +460,722 @@ private:
     QList<DocumentModel::Node *> m_parentNodes;
 };
 
+// Removes the states that can never be entered, and the transitions that can never be taken, from
+// a verified document. A transition can never be taken if it has an event while one of the states
+// it belongs to has an eventless transition without a condition: as long as that state is active,
+// the interpreter keeps taking eventless transitions, so no event is ever processed in it. For the
+// same reason, eventless transitions that follow an unconditional one in the same state are dead.
+class ScxmlPruner
+{
+public:
+    ScxmlPruner(DocumentModel::ScxmlDocument *doc)
+        : m_doc(doc)
+    {}
+
+    QStringList prune()
+    {
+        if (!m_doc->root)
+            return QStringList();
+
+        findDeadTransitions(m_doc->root->children, nullptr);
+
+        follow(m_doc->root->initialTransition);
+        while (!m_worklist.isEmpty())
+            enterClosure(m_worklist.takeLast());
+
+        QStringList report;
+        for (DocumentModel::AbstractState *state : std::as_const(m_doc->allStates)) {
+            if (m_reachable.contains(state))
+                continue;
+            // Only report the outermost state of a pruned subtree.
+            DocumentModel::AbstractState *parent = state->parent->asAbstractState();
+            if (parent == nullptr || m_reachable.contains(parent))
+                report.append(message(stateNode(state)->xmlLocation,
+                                      QStringLiteral("state '%1' is unreachable, removed")
+                                      .arg(state->id)));
+        }
+        for (DocumentModel::Transition *transition : std::as_const(m_doc->allTransitions)) {
+            if (m_dead.contains(transition) && m_reachable.contains(m_sourceState.value(transition)))
+                report.append(message(transition->xmlLocation,
+                                      QStringLiteral("transition can never be taken, removed")));
+        }
+
+        // The data of the removed states is still declared. With early binding, it is also still
+        // initialized when the state machine starts.
+        const bool bindEarly = m_doc->root->binding == DocumentModel::Scxml::EarlyBinding;
+        for (DocumentModel::AbstractState *state : std::as_const(m_doc->allStates)) {
+            DocumentModel::State *s = state->asState();
+            if (s == nullptr || m_reachable.contains(state))
+                continue;
+            for (DocumentModel::DataElement *data : std::as_const(s->dataElements)) {
+                if (bindEarly) {
+                    m_doc->root->dataElements.append(data);
+                } else {
+                    auto declaration = m_doc->newNode<DocumentModel::DataElement>(
+                                data->xmlLocation);
+                    declaration->id = data->id;
+                    declaration->type = data->type;
+                    m_doc->root->dataElements.append(declaration);
+                }
+            }
+        }
+
+        removeChildren(m_doc->root->children);
+        m_live.insert(m_doc->root->initialTransition);
+
+        m_doc->allStates.removeIf([this](DocumentModel::AbstractState *state) {
+            return !m_reachable.contains(state);
+        });
+        m_doc->allTransitions.removeIf([this](DocumentModel::Transition *transition) {
+            return !m_live.contains(transition);
+        });
+
+        return report;
+    }
+
+private:
+    static DocumentModel::Node *stateNode(DocumentModel::AbstractState *state)
+    {
+        if (DocumentModel::State *s = state->asState())
+            return s;
+        return static_cast<DocumentModel::HistoryState *>(state);
+    }
+
+    QString message(const DocumentModel::XmlLocation &location, const QString &msg) const
+    {
+        return QStringLiteral("%1:%2:%3: warning: %4").arg(m_doc->fileName)
+                .arg(location.line).arg(location.column).arg(msg);
+    }
+
+    void findDeadTransitions(const QList<DocumentModel::StateOrTransition *> &children,
+                             DocumentModel::Transition *preempting)
+    {
+        for (DocumentModel::StateOrTransition *sot : children) {
+            if (DocumentModel::HistoryState *h = sot->asHistoryState()) {
+                if (DocumentModel::Transition *t = h->defaultConfiguration())
+                    m_sourceState.insert(t, h);
+                continue;
+            }
+
+            DocumentModel::State *state = sot->asState();
+            if (!state)
+                continue;
+
+            DocumentModel::Transition *ownPreempting = nullptr;
+            for (DocumentModel::StateOrTransition *child : std::as_const(state->children)) {
+                DocumentModel::Transition *t = child->asTransition();
+                if (t && t->events.isEmpty() && t->condition.isNull()) {
+                    ownPreempting = t;
+                    break;
+                }
+            }
+
+            bool seenOwnPreempting = false;
+            for (DocumentModel::StateOrTransition *child : std::as_const(state->children)) {
+                DocumentModel::Transition *t = child->asTransition();
+                if (!t)
+                    continue;
+                m_sourceState.insert(t, state);
+                if (t->events.isEmpty()) {
+                    if (seenOwnPreempting)
+                        m_dead.insert(t);
+                    else if (t == ownPreempting)
+                        seenOwnPreempting = true;
+                } else if (preempting || ownPreempting) {
+                    m_dead.insert(t);
+                }
+            }
+
+            findDeadTransitions(state->children, preempting ? preempting : ownPreempting);
+        }
+    }
+
+    void enter(DocumentModel::AbstractState *state)
+    {
+        if (!m_reachable.contains(state)) {
+            m_reachable.insert(state);
+            m_worklist.append(state);
+        }
+    }
+
+    void follow(DocumentModel::Transition *transition)
+    {
+        if (!transition || m_dead.contains(transition))
+            return;
+        for (DocumentModel::AbstractState *target : std::as_const(transition->targetStates))
+            enter(target);
+    }
+
+    // Everything that may be entered together with the state. This over-approximates the initial
+    // states of compound states that are entered through one of their descendants.
+    void enterClosure(DocumentModel::AbstractState *state)
+    {
+        if (DocumentModel::AbstractState *parent = state->parent->asAbstractState())
+            enter(parent);
+
+        if (DocumentModel::State *s = state->asState()) {
+            if (s->type == DocumentModel::State::Parallel) {
+                for (DocumentModel::StateOrTransition *child : std::as_const(s->children)) {
+                    if (DocumentModel::AbstractState *childState = child->asAbstractState())
+                        enter(childState);
+                }
+            } else {
+                follow(s->initialTransition);
+            }
+            for (DocumentModel::StateOrTransition *child : std::as_const(s->children))
+                follow(child->asTransition());
+        } else {
+            auto *h = static_cast<DocumentModel::HistoryState *>(state);
+            if (DocumentModel::Transition *t = h->defaultConfiguration()) {
+                follow(t);
+            } else if (DocumentModel::State *parent = state->parent->asState()) {
+                follow(parent->initialTransition);
+            }
+        }
+    }
+
+    void removeChildren(QList<DocumentModel::StateOrTransition *> &children)
+    {
+        children.removeIf([this](DocumentModel::StateOrTransition *sot) {
+            if (DocumentModel::Transition *t = sot->asTransition())
+                return m_dead.contains(t);
+            DocumentModel::AbstractState *state = sot->asAbstractState();
+            return state && !m_reachable.contains(state);
+        });
+
+        for (DocumentModel::StateOrTransition *sot : std::as_const(children)) {
+            if (DocumentModel::Transition *t = sot->asTransition()) {
+                m_live.insert(t);
+            } else if (DocumentModel::State *s = sot->asState()) {
+                m_live.insert(s->initialTransition);
+                removeChildren(s->children);
+            } else if (DocumentModel::HistoryState *h = sot->asHistoryState()) {
+                m_live.insert(h->defaultConfiguration());
+            }
+        }
+    }
+
+    DocumentModel::ScxmlDocument *m_doc;
+    QSet<DocumentModel::Transition *> m_dead;
+    QSet<DocumentModel::Transition *> m_live;
+    QHash<DocumentModel::Transition *, DocumentModel::AbstractState *> m_sourceState;
+    QSet<DocumentModel::AbstractState *> m_reachable;
+    QList<DocumentModel::AbstractState *> m_worklist;
+};
+
+// Evaluates the ECMAScript expressions that only consist of boolean and number literals, the
+// operators that can be applied to them without type conversions, and In() of the states that are
+// known to be active. Anything else is not constant, as far as the compiler is concerned.
+class ConstantExpression
+{
+public:
+    struct Value {
+        enum Type { Invalid, Bool, Number };
+        Type type = Invalid;
+        bool boolean = false;
+        double number = 0;
+
+        bool isValid() const { return type != Invalid; }
+        bool isTrue() const { return type == Bool ? boolean : number != 0; }
+    };
+
+    static Value evaluate(QStringView expr, const QStringList &activeStates = QStringList())
+    {
+        ConstantExpression parser(expr, activeStates);
+        Value value = parser.equality();
+        parser.skipSpaces();
+        return parser.m_pos == parser.m_expr.size() ? value : Value();
+    }
+
+private:
+    ConstantExpression(QStringView expr, const QStringList &activeStates)
+        : m_expr(expr)
+        , m_activeStates(activeStates)
+    {}
+
+    static Value makeBool(bool b) { Value v; v.type = Value::Bool; v.boolean = b; return v; }
+    static Value makeNumber(double n) { Value v; v.type = Value::Number; v.number = n; return v; }
+
+    void skipSpaces()
+    {
+        while (m_pos < m_expr.size() && m_expr.at(m_pos).isSpace())
+            ++m_pos;
+    }
+
+    bool accept(QLatin1String token)
+    {
+        skipSpaces();
+        if (!m_expr.sliced(m_pos).startsWith(token))
+            return false;
+        m_pos += token.size();
+        return true;
+    }
+
+    bool acceptWord(QLatin1String word)
+    {
+        skipSpaces();
+        const qsizetype end = m_pos + word.size();
+        if (!m_expr.sliced(m_pos).startsWith(word))
+            return false;
+        if (end < m_expr.size()) {
+            const QChar next = m_expr.at(end);
+            if (next.isLetterOrNumber() || next == QLatin1Char('_') || next == QLatin1Char('$'))
+                return false;
+        }
+        m_pos = end;
+        return true;
+    }
+
+    // ++ and -- are single tokens, which cannot be applied to literals. So "1--1" and "--1" are
+    // syntax errors, rather than a subtraction and a double negation.
+    bool isIncrementOrDecrement()
+    {
+        skipSpaces();
+        const QStringView rest = m_expr.sliced(m_pos);
+        return rest.startsWith(QLatin1String("++")) || rest.startsWith(QLatin1String("--"));
+    }
+
+    Value equality()
+    {
+        Value left = relational();
+        while (left.isValid()) {
+            // The strict operators have to be tried first, as the others are prefixes of them.
+            bool equal;
+            if (accept(QLatin1String("===")) || accept(QLatin1String("==")))
+                equal = true;
+            else if (accept(QLatin1String("!==")) || accept(QLatin1String("!=")))
+                equal = false;
+            else
+                break;
+
+            const Value right = relational();
+            if (right.type != left.type)
+                return Value(); // Loose comparisons of different types would need conversions.
+            const bool same = left.type == Value::Bool ? left.boolean == right.boolean
+                                                       : left.number == right.number;
+            left = makeBool(same == equal);
+        }
+        return left;
+    }
+
+    Value relational()
+    {
+        Value left = additive();
+        while (left.isValid()) {
+            enum { Less, LessEqual, Greater, GreaterEqual } op;
+            if (accept(QLatin1String("<=")))
+                op = LessEqual;
+            else if (accept(QLatin1String("<")))
+                op = Less;
+            else if (accept(QLatin1String(">=")))
+                op = GreaterEqual;
+            else if (accept(QLatin1String(">")))
+                op = Greater;
+            else
+                break;
+
+            const Value right = additive();
+            if (left.type != Value::Number || right.type != Value::Number)
+                return Value();
+            switch (op) {
+            case Less: left = makeBool(left.number < right.number); break;
+            case LessEqual: left = makeBool(left.number <= right.number); break;
+            case Greater: left = makeBool(left.number > right.number); break;
+            case GreaterEqual: left = makeBool(left.number >= right.number); break;
+            }
+        }
+        return left;
+    }
+
+    Value additive()
+    {
+        Value left = multiplicative();
+        while (left.isValid()) {
+            if (isIncrementOrDecrement())
+                return Value();
+            bool add;
+            if (accept(QLatin1String("+")))
+                add = true;
+            else if (accept(QLatin1String("-")))
+                add = false;
+            else
+                break;
+
+            const Value right = multiplicative();
+            if (left.type != Value::Number || right.type != Value::Number)
+                return Value(); // + also concatenates, and both convert booleans.
+            left = makeNumber(add ? left.number + right.number : left.number - right.number);
+        }
+        return left;
+    }
+
+    Value multiplicative()
+    {
+        Value left = unary();
+        while (left.isValid() && accept(QLatin1String("*"))) {
+            const Value right = unary();
+            if (left.type != Value::Number || right.type != Value::Number)
+                return Value();
+            left = makeNumber(left.number * right.number);
+        }
+        return left;
+    }
+
+    Value unary()
+    {
+        if (isIncrementOrDecrement())
+            return Value();
+        if (accept(QLatin1String("!"))) {
+            const Value operand = unary();
+            return operand.isValid() ? makeBool(!operand.isTrue()) : Value();
+        }
+        if (accept(QLatin1String("-"))) {
+            const Value operand = unary();
+            return operand.type == Value::Number ? makeNumber(-operand.number) : Value();
+        }
+        return primary();
+    }
+
+    Value primary()
+    {
+        if (accept(QLatin1String("("))) {
+            const Value value = equality();
+            return accept(QLatin1String(")")) ? value : Value();
+        }
+        if (acceptWord(QLatin1String("true")))
+            return makeBool(true);
+        if (acceptWord(QLatin1String("false")))
+            return makeBool(false);
+        if (acceptWord(QLatin1String("In")))
+            return in();
+        return numberLiteral();
+    }
+
+    Value in()
+    {
+        if (!accept(QLatin1String("(")))
+            return Value();
+        skipSpaces();
+        if (m_pos == m_expr.size())
+            return Value();
+        const QChar quote = m_expr.at(m_pos);
+        if (quote != QLatin1Char('\'') && quote != QLatin1Char('"'))
+            return Value();
+        const qsizetype end = m_expr.indexOf(quote, m_pos + 1);
+        if (end == -1)
+            return Value();
+        const QStringView id = m_expr.sliced(m_pos + 1, end - m_pos - 1);
+        m_pos = end + 1;
+        if (!accept(QLatin1String(")")))
+            return Value();
+        // States that are not known to be active might still be active, in a parallel region.
+        return m_activeStates.contains(id) ? makeBool(true) : Value();
+    }
+
+    Value numberLiteral()
+    {
+        skipSpaces();
+        const qsizetype begin = m_pos;
+        while (m_pos < m_expr.size() && m_expr.at(m_pos).isDigit())
+            ++m_pos;
+        if (m_pos == begin)
+            return Value();
+        // Leading zeros make a legacy octal literal in sloppy mode.
+        if (m_pos - begin > 1 && m_expr.at(begin) == QLatin1Char('0'))
+            return Value();
+        if (m_pos < m_expr.size() && m_expr.at(m_pos) == QLatin1Char('.')) {
+            const qsizetype fraction = ++m_pos;
+            while (m_pos < m_expr.size() && m_expr.at(m_pos).isDigit())
+                ++m_pos;
+            if (m_pos == fraction)
+                return Value();
+        }
+        if (m_pos < m_expr.size()) {
+            const QChar next = m_expr.at(m_pos);
+            if (next.isLetterOrNumber() || next == QLatin1Char('_') || next == QLatin1Char('$')
+                    || next == QLatin1Char('.')) {
+                return Value(); // exponents, BigInts, property accesses, ...
+            }
+        }
+        bool ok = false;
+        const double n = m_expr.sliced(begin, m_pos - begin).toDouble(&ok);
+        return ok ? makeNumber(n) : Value();
+    }
+
+    QStringView m_expr;
+    const QStringList &m_activeStates;
+    qsizetype m_pos = 0;
+};
+
+// Folds the conditions of transitions and <if> elements, and the expressions of <assign>
+// elements, that have the same value every time they are evaluated. Transitions with a condition
+// that is always false are removed, conditions that are always true are dropped, and the branches
+// of <if> elements that can never be executed are removed. What counts as constant depends on the
+// data model: only In() of the source state or its ancestors for the null data model, the literals
+// true and false for the C++ data model, and simple literal expressions for ECMAScript.
+class ScxmlConstantFolder
+{
+public:
+    ScxmlConstantFolder(DocumentModel::ScxmlDocument *doc)
+        : m_doc(doc)
+    {}
+
+    void fold()
+    {
+        if (!m_doc->root)
+            return;
+
+        foldSequence(m_doc->root->initialSetup);
+        foldChildren(m_doc->root->children);
+
+        bool removedTransitions = false;
+        for (DocumentModel::Transition *transition : std::as_const(m_doc->allTransitions)) {
+            if (m_removed.contains(transition))
+                removedTransitions = true;
+            else
+                foldSequence(transition->instructionsOnTransition);
+        }
+
+        if (removedTransitions) {
+            m_doc->allTransitions.removeIf([this](DocumentModel::Transition *transition) {
+                return m_removed.contains(transition);
+            });
+        }
+    }
+
+private:
+    enum Constant { Unknown, AlwaysFalse, AlwaysTrue };
+
+    Constant constant(const QString &expr, DocumentModel::State *source = nullptr) const
+    {
+        QStringList activeStates;
+        for (DocumentModel::State *s = source; s; s = s->parent->asState()) {
+            if (!s->id.isEmpty())
+                activeStates.append(s->id);
+        }
+
+        switch (m_doc->root->dataModel) {
+        case DocumentModel::Scxml::NullDataModel: {
+            // The null data model can only evaluate In(), with the id of the state unquoted.
+            QString stripped = expr;
+            stripped.removeIf([](QChar ch) { return ch.isSpace(); });
+            if (!stripped.startsWith(QLatin1String("In(")) || !stripped.endsWith(QLatin1Char(')')))
+                return Unknown;
+            const QStringView id = QStringView(stripped).sliced(3, stripped.size() - 4);
+            return activeStates.contains(id) ? AlwaysTrue : Unknown;
+        }
+        case DocumentModel::Scxml::CppDataModel: {
+            const QString trimmed = expr.trimmed();
+            if (trimmed == QLatin1String("true"))
+                return AlwaysTrue;
+            if (trimmed == QLatin1String("false"))
+                return AlwaysFalse;
+            return Unknown;
+        }
+        case DocumentModel::Scxml::JSDataModel: {
+            const auto value = ConstantExpression::evaluate(expr, activeStates);
+            if (!value.isValid())
+                return Unknown;
+            return value.isTrue() ? AlwaysTrue : AlwaysFalse;
+        }
+        }
+        return Unknown;
+    }
+
+    void foldChildren(const QList<DocumentModel::StateOrTransition *> &children)
+    {
+        for (DocumentModel::StateOrTransition *sot : children) {
+            DocumentModel::State *state = sot->asState();
+            if (!state)
+                continue;
+
+            for (DocumentModel::InstructionSequence *sequence : std::as_const(state->onEntry))
+                foldSequence(*sequence);
+            for (DocumentModel::InstructionSequence *sequence : std::as_const(state->onExit))
+                foldSequence(*sequence);
+            for (DocumentModel::Invoke *invoke : std::as_const(state->invokes))
+                foldSequence(invoke->finalize);
+
+            state->children.removeIf([this, state](DocumentModel::StateOrTransition *child) {
+                DocumentModel::Transition *transition = child->asTransition();
+                if (!transition || transition->condition.isNull())
+                    return false;
+                switch (constant(*transition->condition, state)) {
+                case AlwaysTrue:
+                    transition->condition.reset();
+                    return false;
+                case AlwaysFalse:
+                    m_removed.insert(transition);
+                    return true;
+                case Unknown:
+                    break;
+                }
+                return false;
+            });
+
+            foldChildren(state->children);
+        }
+    }
+
+    void foldSequence(DocumentModel::InstructionSequence &sequence)
+    {
+        for (qsizetype i = 0; i < sequence.size(); ++i) {
+            DocumentModel::Instruction *instruction = sequence.at(i);
+            if (DocumentModel::If *ifI = instruction->asIf()) {
+                DocumentModel::InstructionSequence *taken = nullptr;
+                if (foldIf(ifI, &taken)) {
+                    // Nothing is left to choose from: the branch that is always taken, if any,
+                    // replaces the <if> and is folded in its place.
+                    sequence.remove(i);
+                    for (qsizetype j = 0, ej = taken ? taken->size() : 0; j != ej; ++j)
+                        sequence.insert(i + j, taken->at(j));
+                    --i;
+                }
+            } else if (auto *foreachI = instruction->asForeach()) {
+                foldSequence(foreachI->block);
+            } else if (auto *assign = instruction->asAssign()) {
+                foldAssign(assign);
+            }
+        }
+    }
+
+    // Removes the branches that can never be taken. Returns true if the <if> has no conditions
+    // left, with taken set to the block that is always executed, or nullptr if there is none.
+    bool foldIf(DocumentModel::If *ifI, DocumentModel::InstructionSequence **taken)
+    {
+        for (qsizetype i = 0; i < ifI->conditions.size(); ++i) {
+            switch (constant(ifI->conditions.at(i))) {
+            case AlwaysFalse:
+                ifI->conditions.remove(i);
+                ifI->blocks.remove(i);
+                --i;
+                break;
+            case AlwaysTrue:
+                // This branch becomes the <else>, and the ones after it are never reached.
+                ifI->conditions.resize(i);
+                ifI->blocks.resize(i + 1);
+                break;
+            case Unknown:
+                break;
+            }
+        }
+
+        if (!ifI->conditions.isEmpty()) {
+            for (DocumentModel::InstructionSequence *block : std::as_const(ifI->blocks))
+                foldSequence(*block);
+            return false;
+        }
+
+        *taken = ifI->blocks.isEmpty() ? nullptr : ifI->blocks.first();
+        return true;
+    }
+
+    void foldAssign(DocumentModel::Assign *assign)
+    {
+        if (m_doc->root->dataModel != DocumentModel::Scxml::JSDataModel
+                || !assign->content.isEmpty()) {
+            return;
+        }
+
+        const auto value = ConstantExpression::evaluate(assign->expr);
+        switch (value.type) {
+        case ConstantExpression::Value::Invalid:
+            return;
+        case ConstantExpression::Value::Bool:
+            assign->expr = value.boolean ? QStringLiteral("true") : QStringLiteral("false");
+            return;
+        case ConstantExpression::Value::Number:
+            // Only integers are folded, so that the literal is exactly what ECMAScript would
+            // have computed. Negative zero would print as 0.
+            if (std::abs(value.number) <= 9007199254740992.0
+                    && value.number == std::trunc(value.number)
+                    && !(value.number == 0 && std::signbit(value.number))) {
+                assign->expr = QString::number(qint64(value.number));
+            }
+            return;
+        }
+    }
+
+    DocumentModel::ScxmlDocument *m_doc;
+    QSet<DocumentModel::Transition *> m_removed;
+};
+
 #ifndef BUILD_QSCXMLC
+// The tables of a compiled document, and what is needed to create its service factories, so
+// that state machines can be created without the document itself.
+struct DynamicChart
+{
+    struct Factory {
+        QScxmlExecutableContent::InvokeInfo invokeInfo;
+        QList<QScxmlExecutableContent::StringId> names;
+        QList<QScxmlExecutableContent::ParameterInfo> parameters;
+        QSharedPointer<DocumentModel::ScxmlDocument> content;
+    };
+
+    QScxmlInternal::GeneratedTableData table;
+    QScxmlInternal::GeneratedTableData::MetaDataInfo metaDataInfo;
+    QList<Factory> factories;
+    DocumentModel::Scxml::DataModelType dataModel = DocumentModel::Scxml::NullDataModel;
+};
+
+struct ChartCacheKey
+{
+    QString sourceUrl;
+    QByteArray contentHash;
+    // The Loader that resolves the files the chart includes, or nullptr for the default one, which
+    // resolves them the same way for all state machines.
+    const QScxmlCompiler::Loader *loader;
+
+    friend bool operator==(const ChartCacheKey &a, const ChartCacheKey &b)
+    {
+        return a.sourceUrl == b.sourceUrl && a.contentHash == b.contentHash
+                && a.loader == b.loader;
+    }
+
+    friend size_t qHash(const ChartCacheKey &key, size_t seed = 0)
+    { return qHashMulti(seed, key.sourceUrl, key.contentHash, key.loader); }
+};
+
+struct CachedChart
+{
+    DynamicChart chart;
+    QStringList dependencies; // the names of the files the chart includes, as passed to the Loader
+};
+
+// Charts loaded through <invoke src> or srcexpr, shared by all state machines in the process.
+// The cost of an entry is the size of its source.
+struct ChartCache
+{
+    enum { DefaultLimit = 4 * 1024 * 1024 };
+
+    QMutex mutex;
+    QCache<ChartCacheKey, CachedChart> charts { DefaultLimit };
+    QSet<const QScxmlCompiler::Loader *> loaders; // the ones that have charts in the cache
+};
+
+Q_GLOBAL_STATIC(ChartCache, chartCache)
+
+// Forwards to another Loader, and records the names of the files it loads.
+class RecordingLoader: public QScxmlCompiler::Loader
+{
+public:
+    RecordingLoader(QScxmlCompiler::Loader *loader)
+        : m_loader(loader)
+    {}
+
+    QByteArray load(const QString &name, const QString &baseDir, QStringList *errors) override
+    {
+        m_names.append(name);
+        return m_loader->load(name, baseDir, errors);
+    }
+
+    QStringList names() const { return m_names; }
+
+private:
+    QScxmlCompiler::Loader *m_loader;
+    QStringList m_names;
+};
+
 class InvokeDynamicScxmlFactory: public QScxmlInvokableServiceFactory
 {
     Q_OBJECT
@@ -449,6 +1195,24 @@ private:
     QSharedPointer<DocumentModel::ScxmlDocument> m_content;
 };
 
+class InvokeCompiledScxmlFactory: public QScxmlInvokableServiceFactory
+{
+    Q_OBJECT
+public:
+    InvokeCompiledScxmlFactory(const QScxmlInternal::CompiledChart::FactoryInfo &info,
+                               const QSharedPointer<QScxmlInternal::CompiledChartFile> &file)
+        : QScxmlInvokableServiceFactory(info.invokeInfo, info.names, info.parameters)
+        , m_file(file)
+        , m_childChart(info.childChart)
+    {}
+
+    QScxmlInvokableService *invoke(QScxmlStateMachine *child) override;
+
+private:
+    QSharedPointer<QScxmlInternal::CompiledChartFile> m_file;
+    int m_childChart;
+};
+
 class DynamicStateMachinePrivate : public QScxmlStateMachinePrivate
 {
     struct DynamicMetaObject : public QAbstractDynamicMetaObject
@@ -606,6 +1370,67 @@ public:
         return stateMachine;
     }
 
+    static void prepare(DocumentModel::ScxmlDocument *doc, DynamicChart *chart)
+    {
+        DataModelInfo dm;
+        auto factoryIdCreator = [chart](
+                const QScxmlExecutableContent::InvokeInfo &invokeInfo,
+                const QList<QScxmlExecutableContent::StringId> &namelist,
+                const QList<QScxmlExecutableContent::ParameterInfo> &params,
+                const QSharedPointer<DocumentModel::ScxmlDocument> &content) -> int {
+            chart->factories.append({ invokeInfo, namelist, params, content });
+            return chart->factories.size() - 1;
+        };
+
+        GeneratedTableData::build(doc, &chart->table, &chart->metaDataInfo, &dm,
+                                  factoryIdCreator);
+        chart->dataModel = doc->root->dataModel;
+    }
+
+    static DynamicStateMachine *build(const DynamicChart &chart)
+    {
+        auto stateMachine = new DynamicStateMachine;
+        static_cast<GeneratedTableData &>(*stateMachine) = chart.table;
+        for (const DynamicChart::Factory &factoryInfo : chart.factories) {
+            auto factory = new InvokeDynamicScxmlFactory(factoryInfo.invokeInfo, factoryInfo.names,
+                                                         factoryInfo.parameters);
+            factory->setContent(factoryInfo.content);
+            stateMachine->m_allFactoriesById.append(factory);
+        }
+        stateMachine->setTableData(stateMachine);
+        stateMachine->initDynamicParts(chart.metaDataInfo);
+
+        return stateMachine;
+    }
+
+    static DynamicStateMachine *build(const QSharedPointer<QScxmlInternal::CompiledChartFile> &file,
+                                      int chart)
+    {
+        auto stateMachine = new DynamicStateMachine;
+        auto table = new QScxmlInternal::CompiledTableData(
+                    file, chart,
+                    [file](const QScxmlInternal::CompiledChart::FactoryInfo &factoryInfo) {
+            return new InvokeCompiledScxmlFactory(factoryInfo, file);
+        });
+        stateMachine->m_compiledTableData.reset(table);
+        stateMachine->setTableData(table);
+        MetaDataInfo info;
+        info.stateNames = file->stateNames(chart);
+        stateMachine->initDynamicParts(info);
+
+        const auto stateTable = reinterpret_cast<const QScxmlExecutableContent::StateTable *>(
+                    table->stateMachineTable());
+        auto dm = QScxmlDataModelPrivate::instantiateDataModel(
+                    stateTable->dataModel == QScxmlExecutableContent::StateTable::EcmaScriptDataModel
+                    ? DocumentModel::Scxml::JSDataModel : DocumentModel::Scxml::NullDataModel);
+        if (dm) {
+            dm->setParent(stateMachine);
+            stateMachine->setDataModel(dm);
+        }
+
+        return stateMachine;
+    }
+
 private:
     static QList<QByteArray> init(const char *s)
     {
@@ -618,6 +1443,7 @@ private:
 
 private:
     QList<QScxmlInvokableServiceFactory *> m_allFactoriesById;
+    QScopedPointer<QScxmlInternal::CompiledTableData> m_compiledTableData;
     int m_propertyCount;
 };
 
@@ -640,6 +1466,24 @@ inline QScxmlInvokableService *InvokeDynamicScxmlFactory::invoke(
 
     return invokeStaticScxmlService(childStateMachine, parentStateMachine, this);
 }
+
+inline QScxmlInvokableService *InvokeCompiledScxmlFactory::invoke(
+        QScxmlStateMachine *parentStateMachine)
+{
+    bool ok = true;
+    auto srcexpr = calculateSrcexpr(parentStateMachine, invokeInfo().expr, &ok);
+    if (!ok)
+        return nullptr;
+
+    if (!srcexpr.isEmpty())
+        return invokeDynamicScxmlService(srcexpr, parentStateMachine, this);
+
+    if (m_childChart == -1)
+        return nullptr;
+
+    auto childStateMachine = DynamicStateMachine::build(m_file, m_childChart);
+    return invokeStaticScxmlService(childStateMachine, parentStateMachine, this);
+}
 #endif // BUILD_QSCXMLC
 
 } // anonymous namespace
@@ -660,35 +1504,75 @@ QScxmlScxmlService *invokeDynamicScxmlService(const QString &sourceUrl,
         return nullptr;
     }
 
-    QXmlStreamReader reader(data);
-    QScxmlCompiler compiler(&reader);
-    compiler.setFileName(sourceUrl);
-    compiler.setLoader(parentStateMachine->loader());
-    compiler.compile();
-    if (!compiler.errors().isEmpty()) {
-        const auto errors = compiler.errors();
-        for (const QScxmlError &error : errors)
-            qWarning().noquote() << error.toString();
-        return nullptr;
+    const bool isDefaultLoader
+            = loader == &QScxmlStateMachinePrivate::get(parentStateMachine)->m_defaultLoader;
+    const ChartCacheKey key {
+        sourceUrl, QCryptographicHash::hash(data, QCryptographicHash::Sha1),
+        isDefaultLoader ? nullptr : loader
+    };
+    DynamicChart chart;
+    bool cached = false;
+    {
+        ChartCache *cache = chartCache();
+        QMutexLocker locker(&cache->mutex);
+        if (const CachedChart *cachedChart = cache->charts.object(key)) {
+            chart = cachedChart->chart;
+            cached = true;
+        }
     }
 
-    auto mainDoc = QScxmlCompilerPrivate::get(&compiler)->scxmlDocument();
-    if (mainDoc == nullptr) {
-        Q_ASSERT(!compiler.errors().isEmpty());
-        const auto errors = compiler.errors();
-        for (const QScxmlError &error : errors)
-            qWarning().noquote() << error.toString();
-        return nullptr;
+    if (!cached) {
+        RecordingLoader recordingLoader(loader);
+        QXmlStreamReader reader(data);
+        QScxmlCompiler compiler(&reader);
+        compiler.setFileName(sourceUrl);
+        compiler.setLoader(&recordingLoader);
+        compiler.compile();
+        if (!compiler.errors().isEmpty()) {
+            const auto errors = compiler.errors();
+            for (const QScxmlError &error : errors)
+                qWarning().noquote() << error.toString();
+            return nullptr;
+        }
+
+        auto mainDoc = QScxmlCompilerPrivate::get(&compiler)->scxmlDocument();
+        if (mainDoc == nullptr) {
+            Q_ASSERT(!compiler.errors().isEmpty());
+            const auto errors = compiler.errors();
+            for (const QScxmlError &error : errors)
+                qWarning().noquote() << error.toString();
+            return nullptr;
+        }
+
+        DynamicStateMachine::prepare(mainDoc, &chart);
+
+        // The default loader cannot tell when an included file changes, and the contents of those
+        // files are compiled into the chart. So such charts are not cached.
+        const QStringList dependencies = recordingLoader.names();
+        if (key.loader || dependencies.isEmpty()) {
+            auto newChart = new CachedChart { chart, dependencies };
+            ChartCache *cache = chartCache();
+            QMutexLocker locker(&cache->mutex);
+            if (key.loader)
+                cache->loaders.insert(key.loader);
+            cache->charts.insert(key, newChart, qMax(data.size(), qsizetype(1)));
+        }
     }
 
-    auto childStateMachine = DynamicStateMachine::build(mainDoc);
+    auto childStateMachine = DynamicStateMachine::build(chart);
 
-    auto dm = QScxmlDataModelPrivate::instantiateDataModel(mainDoc->root->dataModel);
+    auto dm = QScxmlDataModelPrivate::instantiateDataModel(chart.dataModel);
     dm->setParent(childStateMachine);
     childStateMachine->setDataModel(dm);
 
     return invokeStaticScxmlService(childStateMachine, parentStateMachine, factory);
 }
+
+QScxmlStateMachine *QScxmlInternal::instantiateCompiledChart(
+        const QSharedPointer<QScxmlInternal::CompiledChartFile> &file, int chart)
+{
+    return DynamicStateMachine::build(file, chart);
+}
 #endif // BUILD_QSCXMLC
 
 /*!
@@ -996,143 +1880,164 @@ bool QScxmlCompilerPrivate::ParserState::isExecutableContent(ParserState::Kind k
     return false;
 }
 
-QScxmlCompilerPrivate::ParserState::Kind QScxmlCompilerPrivate::ParserState::nameToParserStateKind(QStringView name)
+namespace {
+// Element and attribute names are looked up through perfect hashes of their length and of their
+// first and last characters. The factors were chosen so that the names below do not collide;
+// adding a name may require different ones, which the assertion in the constructor catches.
+template<uint FirstFactor, uint LastFactor>
+class NameLookup
+{
+public:
+    enum { NotFound = -1 };
+
+    template<size_t Count>
+    NameLookup(const QLatin1String (&names)[Count])
+        : m_names(names)
+    {
+        std::fill(std::begin(m_slots), std::end(m_slots), qint8(NotFound));
+        for (size_t i = 0; i < Count; ++i) {
+            const uint slot = hash(names[i]);
+            Q_ASSERT(m_slots[slot] == NotFound);
+            m_slots[slot] = qint8(i);
+        }
+    }
+
+    int indexOf(QStringView name) const
+    {
+        if (name.isEmpty())
+            return NotFound;
+        const int index = m_slots[hash(name)];
+        return index != NotFound && name == m_names[index] ? index : NotFound;
+    }
+
+private:
+    enum { SlotCount = 64 };
+
+    template<typename String>
+    static uint hash(const String &name)
+    {
+        return (uint(name.size()) + FirstFactor * uint(name.front().unicode())
+                + LastFactor * uint(name.back().unicode())) % SlotCount;
+    }
+
+    const QLatin1String *m_names;
+    qint8 m_slots[SlotCount];
+};
+
+// In the order of QScxmlCompilerPrivate::ParserState::Kind.
+const QLatin1String elementNames[] = {
+    QLatin1String("scxml"), QLatin1String("state"), QLatin1String("parallel"),
+    QLatin1String("transition"), QLatin1String("initial"), QLatin1String("final"),
+    QLatin1String("onentry"), QLatin1String("onexit"), QLatin1String("history"),
+    QLatin1String("raise"), QLatin1String("if"), QLatin1String("elseif"), QLatin1String("else"),
+    QLatin1String("foreach"), QLatin1String("log"), QLatin1String("datamodel"),
+    QLatin1String("data"), QLatin1String("assign"), QLatin1String("donedata"),
+    QLatin1String("content"), QLatin1String("param"), QLatin1String("script"),
+    QLatin1String("send"), QLatin1String("cancel"), QLatin1String("invoke"),
+    QLatin1String("finalize")
+};
+
+enum Attribute {
+    VersionAttribute, InitialAttribute, DatamodelAttribute, BindingAttribute, NameAttribute,
+    IdAttribute, EventAttribute, CondAttribute, TargetAttribute, TypeAttribute, IndexAttribute,
+    LabelAttribute, ExprAttribute, SrcAttribute, LocationAttribute, EventexprAttribute,
+    IdlocationAttribute, TypeexprAttribute, NamelistAttribute, DelayAttribute,
+    DelayexprAttribute, TargetexprAttribute, SendidAttribute, SendidexprAttribute,
+    SrcexprAttribute, AutoforwardAttribute, ArrayAttribute, ItemAttribute, AttributeCount
+};
+
+// In the order of Attribute.
+const QLatin1String attributeNames[] = {
+    QLatin1String("version"), QLatin1String("initial"), QLatin1String("datamodel"),
+    QLatin1String("binding"), QLatin1String("name"), QLatin1String("id"), QLatin1String("event"),
+    QLatin1String("cond"), QLatin1String("target"), QLatin1String("type"),
+    QLatin1String("index"), QLatin1String("label"), QLatin1String("expr"),
+    QLatin1String("src"), QLatin1String("location"), QLatin1String("eventexpr"),
+    QLatin1String("idlocation"), QLatin1String("typeexpr"), QLatin1String("namelist"),
+    QLatin1String("delay"), QLatin1String("delayexpr"), QLatin1String("targetexpr"),
+    QLatin1String("sendid"), QLatin1String("sendidexpr"), QLatin1String("srcexpr"),
+    QLatin1String("autoforward"), QLatin1String("array"), QLatin1String("item")
+};
+
+static_assert(sizeof(attributeNames) / sizeof(attributeNames[0]) == AttributeCount,
+              "attributeNames has to match Attribute");
+static_assert(AttributeCount <= 32, "The attribute sets are stored as 32 bit masks");
+
+constexpr quint32 attributeSet() { return 0; }
+
+template<typename... Attributes>
+constexpr quint32 attributeSet(Attribute first, Attributes... rest)
 {
-    static QMap<QString, ParserState::Kind> nameToKind;
-    if (nameToKind.isEmpty()) {
-        nameToKind.insert(QLatin1String("scxml"),       Scxml);
-        nameToKind.insert(QLatin1String("state"),       State);
-        nameToKind.insert(QLatin1String("parallel"),    Parallel);
-        nameToKind.insert(QLatin1String("transition"),  Transition);
-        nameToKind.insert(QLatin1String("initial"),     Initial);
-        nameToKind.insert(QLatin1String("final"),       Final);
-        nameToKind.insert(QLatin1String("onentry"),     OnEntry);
-        nameToKind.insert(QLatin1String("onexit"),      OnExit);
-        nameToKind.insert(QLatin1String("history"),     History);
-        nameToKind.insert(QLatin1String("raise"),       Raise);
-        nameToKind.insert(QLatin1String("if"),          If);
-        nameToKind.insert(QLatin1String("elseif"),      ElseIf);
-        nameToKind.insert(QLatin1String("else"),        Else);
-        nameToKind.insert(QLatin1String("foreach"),     Foreach);
-        nameToKind.insert(QLatin1String("log"),         Log);
-        nameToKind.insert(QLatin1String("datamodel"),   DataModel);
-        nameToKind.insert(QLatin1String("data"),        Data);
-        nameToKind.insert(QLatin1String("assign"),      Assign);
-        nameToKind.insert(QLatin1String("donedata"),    DoneData);
-        nameToKind.insert(QLatin1String("content"),     Content);
-        nameToKind.insert(QLatin1String("param"),       Param);
-        nameToKind.insert(QLatin1String("script"),      Script);
-        nameToKind.insert(QLatin1String("send"),        Send);
-        nameToKind.insert(QLatin1String("cancel"),      Cancel);
-        nameToKind.insert(QLatin1String("invoke"),      Invoke);
-        nameToKind.insert(QLatin1String("finalize"),    Finalize);
-    }
-    QMap<QString, ParserState::Kind>::ConstIterator it = nameToKind.constBegin();
-    const QMap<QString, ParserState::Kind>::ConstIterator itEnd = nameToKind.constEnd();
-    while (it != itEnd) {
-        if (it.key() == name)
-            return it.value();
-        ++it;
-    }
-    return None;
-}
-
-QStringList QScxmlCompilerPrivate::ParserState::requiredAttributes(QScxmlCompilerPrivate::ParserState::Kind kind)
+    return (1u << first) | attributeSet(rest...);
+}
+
+struct ElementAttributes {
+    quint32 required;
+    quint32 optional;
+};
+
+// In the order of QScxmlCompilerPrivate::ParserState::Kind, including None.
+constexpr ElementAttributes elementAttributes[] = {
+    { attributeSet(VersionAttribute),                                       // scxml
+      attributeSet(InitialAttribute, DatamodelAttribute, BindingAttribute, NameAttribute) },
+    { 0, attributeSet(IdAttribute, InitialAttribute) },                     // state
+    { 0, attributeSet(IdAttribute) },                                       // parallel
+    { 0, attributeSet(EventAttribute, CondAttribute, TargetAttribute,       // transition
+                      TypeAttribute) },
+    { 0, 0 },                                                               // initial
+    { 0, attributeSet(IdAttribute) },                                       // final
+    { 0, 0 },                                                               // onentry
+    { 0, 0 },                                                               // onexit
+    { 0, attributeSet(IdAttribute, TypeAttribute) },                        // history
+    { attributeSet(EventAttribute), 0 },                                    // raise
+    { attributeSet(CondAttribute), 0 },                                     // if
+    { attributeSet(CondAttribute), 0 },                                     // elseif
+    { 0, 0 },                                                               // else
+    { attributeSet(ArrayAttribute, ItemAttribute), attributeSet(IndexAttribute) }, // foreach
+    { 0, attributeSet(LabelAttribute, ExprAttribute) },                     // log
+    { 0, 0 },                                                               // datamodel
+    { attributeSet(IdAttribute),                                            // data
+      attributeSet(SrcAttribute, ExprAttribute, TypeAttribute) },
+    { attributeSet(LocationAttribute), attributeSet(ExprAttribute) },       // assign
+    { 0, 0 },                                                               // donedata
+    { 0, attributeSet(ExprAttribute) },                                     // content
+    { attributeSet(NameAttribute),                                          // param
+      attributeSet(ExprAttribute, LocationAttribute) },
+    { 0, attributeSet(SrcAttribute) },                                      // script
+    { 0, attributeSet(EventAttribute, EventexprAttribute, IdAttribute,      // send
+                      IdlocationAttribute, TypeAttribute, TypeexprAttribute,
+                      NamelistAttribute, DelayAttribute, DelayexprAttribute,
+                      TargetAttribute, TargetexprAttribute) },
+    { 0, attributeSet(SendidAttribute, SendidexprAttribute) },              // cancel
+    { 0, attributeSet(TypeAttribute, TypeexprAttribute, SrcAttribute,       // invoke
+                      SrcexprAttribute, IdAttribute, IdlocationAttribute,
+                      NamelistAttribute, AutoforwardAttribute) },
+    { 0, 0 },                                                               // finalize
+    { 0, 0 }                                                                // none
+};
+
+typedef NameLookup<7, 1> ElementNameLookup;
+typedef NameLookup<12, 10> AttributeNameLookup;
+
+const ElementNameLookup &elementNameLookup()
 {
-    switch (kind) {
-    case Scxml:      return QStringList() << QStringLiteral("version");
-    case State:      return QStringList();
-    case Parallel:   return QStringList();
-    case Transition: return QStringList();
-    case Initial:    return QStringList();
-    case Final:      return QStringList();
-    case OnEntry:    return QStringList();
-    case OnExit:     return QStringList();
-    case History:    return QStringList();
-    case Raise:      return QStringList() << QStringLiteral("event");
-    case If:         return QStringList() << QStringLiteral("cond");
-    case ElseIf:     return QStringList() << QStringLiteral("cond");
-    case Else:       return QStringList();
-    case Foreach:    return QStringList() << QStringLiteral("array")
-                                          << QStringLiteral("item");
-    case Log:        return QStringList();
-    case DataModel:  return QStringList();
-    case Data:       return QStringList() << QStringLiteral("id");
-    case Assign:     return QStringList() << QStringLiteral("location");
-    case DoneData:   return QStringList();
-    case Content:    return QStringList();
-    case Param:      return QStringList() << QStringLiteral("name");
-    case Script:     return QStringList();
-    case Send:       return QStringList();
-    case Cancel:     return QStringList();
-    case Invoke:     return QStringList();
-    case Finalize:   return QStringList();
-    default:         return QStringList();
-    }
-    return QStringList();
-}
-
-QStringList QScxmlCompilerPrivate::ParserState::optionalAttributes(QScxmlCompilerPrivate::ParserState::Kind kind)
+    static const ElementNameLookup lookup(elementNames);
+    return lookup;
+}
+
+const AttributeNameLookup &attributeNameLookup()
 {
-    switch (kind) {
-    case Scxml:      return QStringList() << QStringLiteral("initial")
-                                          << QStringLiteral("datamodel")
-                                          << QStringLiteral("binding")
-                                          << QStringLiteral("name");
-    case State:      return QStringList() << QStringLiteral("id")
-                                          << QStringLiteral("initial");
-    case Parallel:   return QStringList() << QStringLiteral("id");
-    case Transition: return QStringList() << QStringLiteral("event")
-                                          << QStringLiteral("cond")
-                                          << QStringLiteral("target")
-                                          << QStringLiteral("type");
-    case Initial:    return QStringList();
-    case Final:      return QStringList() << QStringLiteral("id");
-    case OnEntry:    return QStringList();
-    case OnExit:     return QStringList();
-    case History:    return QStringList() << QStringLiteral("id")
-                                          << QStringLiteral("type");
-    case Raise:      return QStringList();
-    case If:         return QStringList();
-    case ElseIf:     return QStringList();
-    case Else:       return QStringList();
-    case Foreach:    return QStringList() << QStringLiteral("index");
-    case Log:        return QStringList() << QStringLiteral("label")
-                                          << QStringLiteral("expr");
-    case DataModel:  return QStringList();
-    case Data:       return QStringList() << QStringLiteral("src")
-                                          << QStringLiteral("expr");
-    case Assign:     return QStringList() << QStringLiteral("expr");
-    case DoneData:   return QStringList();
-    case Content:    return QStringList() << QStringLiteral("expr");
-    case Param:      return QStringList() << QStringLiteral("expr")
-                                          << QStringLiteral("location");
-    case Script:     return QStringList() << QStringLiteral("src");
-    case Send:       return QStringList() << QStringLiteral("event")
-                                          << QStringLiteral("eventexpr")
-                                          << QStringLiteral("id")
-                                          << QStringLiteral("idlocation")
-                                          << QStringLiteral("type")
-                                          << QStringLiteral("typeexpr")
-                                          << QStringLiteral("namelist")
-                                          << QStringLiteral("delay")
-                                          << QStringLiteral("delayexpr")
-                                          << QStringLiteral("target")
-                                          << QStringLiteral("targetexpr");
-    case Cancel:     return QStringList() << QStringLiteral("sendid")
-                                          << QStringLiteral("sendidexpr");
-    case Invoke:     return QStringList() << QStringLiteral("type")
-                                          << QStringLiteral("typeexpr")
-                                          << QStringLiteral("src")
-                                          << QStringLiteral("srcexpr")
-                                          << QStringLiteral("id")
-                                          << QStringLiteral("idlocation")
-                                          << QStringLiteral("namelist")
-                                          << QStringLiteral("autoforward");
-    case Finalize:   return QStringList();
-    default:         return QStringList();
-    }
-    return QStringList();
+    static const AttributeNameLookup lookup(attributeNames);
+    return lookup;
+}
+} // anonymous namespace
+
+QScxmlCompilerPrivate::ParserState::Kind QScxmlCompilerPrivate::ParserState::nameToParserStateKind(QStringView name)
+{
+    static_assert(sizeof(elementNames) / sizeof(elementNames[0]) == None,
+                  "elementNames has to match ParserState::Kind");
+    const int index = elementNameLookup().indexOf(name);
+    return index == ElementNameLookup::NotFound ? None : Kind(index);
 }
 
 DocumentModel::Node::~Node()
@@ -1290,7 +2195,22 @@ QScxmlCompiler::Loader::Loader()
  * Destroys the loader.
  */
 QScxmlCompiler::Loader::~Loader()
-{}
+{
+#ifndef BUILD_QSCXMLC
+    // Another loader can get the same address, so the charts this one loaded cannot be reused.
+    if (!chartCache.exists())
+        return;
+    ChartCache *cache = chartCache();
+    QMutexLocker locker(&cache->mutex);
+    if (!cache->loaders.remove(this))
+        return;
+    const auto keys = cache->charts.keys();
+    for (const ChartCacheKey &key : keys) {
+        if (key.loader == this)
+            cache->charts.remove(key);
+    }
+#endif // BUILD_QSCXMLC
+}
 
 /*!
  * \fn QScxmlCompiler::Loader::load(const QString &name, const QString &baseDir, QStringList *errors)
@@ -1301,6 +2221,92 @@ QScxmlCompiler::Loader::~Loader()
  * Returns a QByteArray that stores the contents of the file.
  */
 
+#ifndef BUILD_QSCXMLC
+/*!
+ * \since 6.6
+ *
+ * Returns the maximum total size, in bytes of SCXML source, of the charts that are kept in the
+ * process-wide chart cache.
+ *
+ * State machines that are invoked with \c src or \c srcexpr are loaded with the Loader of the
+ * invoking state machine every time they are invoked. The compiled tables of such a chart are
+ * cached by the URL it was loaded from, by a hash of its contents, and by the Loader, so that
+ * loading the same contents again doesn't parse and compile them again. When the total size of
+ * the cached charts exceeds the limit, the charts that were used least recently are discarded.
+ * The charts loaded by a Loader are discarded when it is destroyed.
+ *
+ * Charts that include other files through \c{<invoke src>}, \c{<script src>} or
+ * \c{<data src>} are only cached if the invoking state machine has a custom Loader, as the
+ * contents of those files are compiled into the chart.
+ *
+ * The default limit is 4 MiB.
+ *
+ * \sa setChartCacheLimit(), invalidateCachedChart()
+ */
+qsizetype QScxmlCompiler::chartCacheLimit()
+{
+    ChartCache *cache = chartCache();
+    QMutexLocker locker(&cache->mutex);
+    return cache->charts.maxCost();
+}
+
+/*!
+ * \since 6.6
+ *
+ * Sets the maximum total size of the charts in the chart cache to \a limit bytes of SCXML
+ * source. Setting a limit of 0 disables the cache.
+ *
+ * \sa chartCacheLimit()
+ */
+void QScxmlCompiler::setChartCacheLimit(qsizetype limit)
+{
+    ChartCache *cache = chartCache();
+    QMutexLocker locker(&cache->mutex);
+    cache->charts.setMaxCost(qMax(limit, qsizetype(0)));
+}
+
+/*!
+ * \since 6.6
+ *
+ * Removes all charts that were loaded from \a sourceUrl, or that include it, from the chart
+ * cache.
+ *
+ * As the cache is keyed by the contents of a chart, changes to the chart itself are picked up
+ * automatically. Charts that include other files are only cached for custom Loaders. Such a
+ * Loader should call this method when a file that a chart includes through \c{<invoke src>},
+ * \c{<script src>} or \c{<data src>} changes, because the contents of such files are compiled
+ * into the chart. Included files are matched by the name that was passed to Loader::load().
+ *
+ * \sa clearChartCache(), chartCacheLimit()
+ */
+void QScxmlCompiler::invalidateCachedChart(const QString &sourceUrl)
+{
+    ChartCache *cache = chartCache();
+    QMutexLocker locker(&cache->mutex);
+    const auto keys = cache->charts.keys();
+    for (const ChartCacheKey &key : keys) {
+        if (key.sourceUrl == sourceUrl
+                || cache->charts.object(key)->dependencies.contains(sourceUrl)) {
+            cache->charts.remove(key);
+        }
+    }
+}
+
+/*!
+ * \since 6.6
+ *
+ * Removes all charts from the chart cache.
+ *
+ * \sa invalidateCachedChart()
+ */
+void QScxmlCompiler::clearChartCache()
+{
+    ChartCache *cache = chartCache();
+    QMutexLocker locker(&cache->mutex);
+    cache->charts.clear();
+}
+#endif // BUILD_QSCXMLC
+
 QScxmlCompilerPrivate *QScxmlCompilerPrivate::get(QScxmlCompiler *compiler)
 {
     return compiler->d;
@@ -1321,10 +2327,28 @@ bool QScxmlCompilerPrivate::verifyDocument()
         this->addError(location, msg);
     };
 
-    if (ScxmlVerifier(handler).verify(m_doc.get()))
-        return true;
-    else
+    if (!ScxmlVerifier(handler).verify(m_doc.get()))
         return false;
+
+    foldConstants(m_doc.get());
+    return true;
+}
+
+void QScxmlCompilerPrivate::foldConstants(DocumentModel::ScxmlDocument *doc)
+{
+    Q_ASSERT(doc->isVerified);
+    ScxmlConstantFolder(doc).fold();
+    for (DocumentModel::ScxmlDocument *subDoc : std::as_const(doc->allSubDocuments))
+        foldConstants(subDoc);
+}
+
+QStringList QScxmlCompilerPrivate::pruneUnreachable(DocumentModel::ScxmlDocument *doc)
+{
+    Q_ASSERT(doc->isVerified);
+    QStringList report = ScxmlPruner(doc).prune();
+    for (DocumentModel::ScxmlDocument *subDoc : std::as_const(doc->allSubDocuments))
+        report += pruneUnreachable(subDoc);
+    return report;
 }
 
 DocumentModel::ScxmlDocument *QScxmlCompilerPrivate::scxmlDocument() const
@@ -1373,7 +2397,7 @@ bool QScxmlCompilerPrivate::parseSubElement(DocumentModel::Invoke *parentInvoke,
     p.setFileName(fileName);
     p.setLoader(loader());
     p.d->resetDocument();
-    bool ok = p.d->readElement();
+    bool ok = p.d->readElement(ParserState::Scxml);
     parentInvoke->content.reset(p.d->m_doc.release());
     m_doc->allSubDocuments.append(parentInvoke->content.data());
     m_errors.append(p.errors());
@@ -1386,7 +2410,7 @@ bool QScxmlCompilerPrivate::preReadElementScxml()
         addError(QLatin1String("Doc root already allocated"));
         return false;
     }
-    m_doc->root = new DocumentModel::Scxml(xmlLocation());
+    m_doc->root = m_doc->newNode<DocumentModel::Scxml>(xmlLocation());
 
     auto scxml = m_doc->root;
     const QXmlStreamAttributes attributes = m_reader->attributes();
@@ -1680,6 +2704,12 @@ bool QScxmlCompilerPrivate::preReadElementData()
     data->id = attributes.value(QLatin1String("id")).toString();
     data->src = attributes.value(QLatin1String("src")).toString();
     data->expr = attributes.value(QLatin1String("expr")).toString();
+    if (attributes.hasAttribute(QLatin1String("type"))) {
+        // Only the Qt extension qt:type is allowed, it is not part of SCXML.
+        addError(QStringLiteral("Unexpected attribute 'type'"));
+        return false;
+    }
+    data->type = attributes.value(qtScxmlNamespace, QLatin1String("type")).toString();
     if (DocumentModel::Scxml *scxml = m_currentState->asScxml()) {
         scxml->dataElements.append(data);
     } else if (DocumentModel::State *state = m_currentState->asState()) {
@@ -2112,7 +3142,7 @@ bool QScxmlCompilerPrivate::readDocument()
                 addError(QStringLiteral("Unknown element %1").arg(newTag.toString()));
                 m_reader->skipCurrentElement();
             } else if (newElementKind == ParserState::Scxml) {
-                if (readElement() == false)
+                if (readElement(newElementKind) == false)
                     return false;
             } else {
                 addError(QStringLiteral("Unexpected element %1").arg(newTag.toString()));
@@ -2140,13 +3170,11 @@ bool QScxmlCompilerPrivate::readDocument()
     return true;
 }
 
-bool QScxmlCompilerPrivate::readElement()
+bool QScxmlCompilerPrivate::readElement(ParserState::Kind elementKind)
 {
     const QStringView currentTag = m_reader->name();
     const QXmlStreamAttributes attributes = m_reader->attributes();
 
-    const ParserState::Kind elementKind = ParserState::nameToParserStateKind(currentTag);
-
     if (!checkAttributes(attributes, elementKind))
         return false;
 
@@ -2218,7 +3246,7 @@ bool QScxmlCompilerPrivate::readElement()
                 addError(QStringLiteral("Unknown element %1").arg(newTag.toString()));
                 m_reader->skipCurrentElement();
             } else if (pNew.validChild(newElementKind)) {
-                if (readElement() == false)
+                if (readElement(newElementKind) == false)
                     return false;
             } else {
                 addError(QStringLiteral("Unexpected element %1").arg(newTag.toString()));
@@ -2393,30 +3421,34 @@ bool QScxmlCompilerPrivate::hasPrevious() const
 bool QScxmlCompilerPrivate::checkAttributes(const QXmlStreamAttributes &attributes,
                                           QScxmlCompilerPrivate::ParserState::Kind kind)
 {
-    return checkAttributes(attributes,
-                           ParserState::requiredAttributes(kind),
-                           ParserState::optionalAttributes(kind));
-}
-
-bool QScxmlCompilerPrivate::checkAttributes(const QXmlStreamAttributes &attributes,
-                                          const QStringList &requiredNames,
-                                          const QStringList &optionalNames)
-{
-    QStringList required = requiredNames;
+    static_assert(sizeof(elementAttributes) / sizeof(elementAttributes[0]) == ParserState::None + 1,
+                  "elementAttributes has to match ParserState::Kind");
+    const ElementAttributes &allowed = elementAttributes[kind];
+    quint32 seen = 0;
     for (const QXmlStreamAttribute &attribute : attributes) {
         const QStringView ns = attribute.namespaceUri();
         if (!ns.isEmpty() && ns != scxmlNamespace && ns != qtScxmlNamespace)
             continue;
 
-        const QString name = attribute.name().toString();
-        if (!required.removeOne(name) && !optionalNames.contains(name)) {
-            addError(QStringLiteral("Unexpected attribute '%1'").arg(name));
+        const QStringView name = attribute.name();
+        const int index = attributeNameLookup().indexOf(name);
+        const quint32 bit = index == AttributeNameLookup::NotFound ? 0 : 1u << index;
+        if (!(bit & (allowed.required | allowed.optional))) {
+            addError(QStringLiteral("Unexpected attribute '%1'").arg(name.toString()));
             return false;
         }
+        seen |= bit;
     }
-    if (!required.isEmpty()) {
+
+    const quint32 missing = allowed.required & ~seen;
+    if (missing) {
+        QStringList names;
+        for (int i = 0; i < AttributeCount; ++i) {
+            if (missing & (1u << i))
+                names.append(attributeNames[i]);
+        }
         addError(QStringLiteral("Missing required attributes: '%1'")
-                 .arg(required.join(QLatin1String("', '"))));
+                 .arg(names.join(QLatin1String("', '"))));
         return false;
     }
     return true;
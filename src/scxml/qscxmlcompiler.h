@@ -38,6 +38,11 @@ public:
     QScxmlStateMachine *compile();
     QList<QScxmlError> errors() const;
 
+    static qsizetype chartCacheLimit();
+    static void setChartCacheLimit(qsizetype limit);
+    static void invalidateCachedChart(const QString &sourceUrl);
+    static void clearChartCache();
+
 private:
     friend class QScxmlCompilerPrivate;
     QScxmlCompilerPrivate *d;
@@ -41,6 +41,8 @@ struct XmlLocation
 };
 
 struct If;
+struct Foreach;
+struct Assign;
 struct Send;
 struct Invoke;
 struct Script;
@@ -58,6 +60,8 @@ struct Node {
     virtual void accept(NodeVisitor *visitor) = 0;
 
     virtual If *asIf() { return nullptr; }
+    virtual Foreach *asForeach() { return nullptr; }
+    virtual Assign *asAssign() { return nullptr; }
     virtual Send *asSend() { return nullptr; }
     virtual Invoke *asInvoke() { return nullptr; }
     virtual Script *asScript() { return nullptr; }
@@ -77,6 +81,7 @@ struct DataElement: public Node
     QString src;
     QString expr;
     QString content;
+    QString type; // qt:type, C++ data model only
 
     DataElement(const XmlLocation &xmlLocation): Node(xmlLocation) {}
     void accept(NodeVisitor *visitor) override;
@@ -187,6 +192,7 @@ struct Assign: public Instruction
     QString content;
 
     Assign(const XmlLocation &xmlLocation): Instruction(xmlLocation) {}
+    Assign *asAssign() override { return this; }
     void accept(NodeVisitor *visitor) override;
 };
 
@@ -208,6 +214,7 @@ struct Foreach: public Instruction
     InstructionSequence block;
 
     Foreach(const XmlLocation &xmlLocation): Instruction(xmlLocation) {}
+    Foreach *asForeach() override { return this; }
     void accept(NodeVisitor *visitor) override;
 };
 
@@ -368,6 +375,48 @@ struct Scxml: public StateContainer, public Node
     void accept(NodeVisitor *visitor) override;
 };
 
+// Hands out memory for the nodes and instruction sequences of a document from large blocks, and
+// releases all of it at once, so that big documents don't need a malloc and a free per element.
+// Destructors are not run by the arena.
+class Arena
+{
+    Q_DISABLE_COPY(Arena)
+public:
+    Arena() = default;
+
+    ~Arena()
+    {
+        for (char *block : std::as_const(m_blocks))
+            ::operator delete(block);
+    }
+
+    void *allocate(size_t size, size_t alignment)
+    {
+        Q_ASSERT(alignment <= alignof(std::max_align_t));
+        size_t offset = (m_used + alignment - 1) & ~(alignment - 1);
+        if (m_blocks.isEmpty() || offset + size > m_blockSize) {
+            m_blockSize = qMax(size, size_t(BlockSize));
+            m_blocks.append(static_cast<char *>(::operator new(m_blockSize)));
+            offset = 0;
+        }
+        m_used = offset + size;
+        return m_blocks.last() + offset;
+    }
+
+    template<typename T, typename... Args>
+    T *create(Args &&... args)
+    {
+        return new (allocate(sizeof(T), alignof(T))) T(std::forward<Args>(args)...);
+    }
+
+private:
+    enum { BlockSize = 16 * 1024 };
+
+    QList<char *> m_blocks;
+    size_t m_used = 0;
+    size_t m_blockSize = 0;
+};
+
 struct ScxmlDocument
 {
     const QString fileName;
@@ -387,9 +436,11 @@ struct ScxmlDocument
 
     ~ScxmlDocument()
     {
-        delete root;
-        qDeleteAll(allNodes);
-        qDeleteAll(allSequences);
+        // The memory itself is released by the arena.
+        for (Node *node : std::as_const(allNodes))
+            node->~Node();
+        for (InstructionSequence *sequence : std::as_const(allSequences))
+            sequence->~InstructionSequence();
     }
 
     State *newState(StateContainer *parent, State::Type type, const XmlLocation &xmlLocation)
@@ -426,7 +477,7 @@ struct ScxmlDocument
     template<typename T>
     T *newNode(const XmlLocation &xmlLocation)
     {
-        T *node = new T(xmlLocation);
+        T *node = arena.create<T>(xmlLocation);
         allNodes.append(node);
         return node;
     }
@@ -434,11 +485,14 @@ struct ScxmlDocument
     InstructionSequence *newSequence(InstructionSequences *container)
     {
         Q_ASSERT(container);
-        InstructionSequence *is = new InstructionSequence;
+        InstructionSequence *is = arena.create<InstructionSequence>();
         allSequences.append(is);
         container->append(is);
         return is;
     }
+
+private:
+    Arena arena;
 };
 
 class Q_SCXML_EXPORT NodeVisitor
@@ -526,6 +580,14 @@ public:
     bool verifyDocument();
     DocumentModel::ScxmlDocument *scxmlDocument() const;
 
+    // Folds the conditions and expressions of a verified document and its sub-documents that
+    // always have the same value. Called by verifyDocument().
+    static void foldConstants(DocumentModel::ScxmlDocument *doc);
+
+    // Removes unreachable states and transitions that can never be taken from a verified
+    // document and its sub-documents. Returns a warning for everything that was removed.
+    static QStringList pruneUnreachable(DocumentModel::ScxmlDocument *doc);
+
     QString fileName() const;
     void setFileName(const QString &fileName);
 
@@ -553,9 +615,6 @@ private:
     DocumentModel::XmlLocation xmlLocation() const;
     bool maybeId(const QXmlStreamAttributes &attributes, QString *id);
     DocumentModel::If *lastIf();
-    bool checkAttributes(const QXmlStreamAttributes &attributes,
-                         const QStringList &requiredNames,
-                         const QStringList &optionalNames);
 
     bool preReadElementScxml();
     bool preReadElementState();
@@ -611,8 +670,6 @@ private:
     bool postReadElementInvoke();
     bool postReadElementFinalize();
 
-    bool readElement();
-
     void resetDocument();
     void currentStateUp();
     bool flushInstruction();
@@ -662,8 +719,6 @@ private:
         static bool validChild(ParserState::Kind parent, ParserState::Kind child);
         static bool isExecutableContent(ParserState::Kind kind);
         static Kind nameToParserStateKind(QStringView name);
-        static QStringList requiredAttributes(Kind kind);
-        static QStringList optionalAttributes(Kind kind);
     };
 
 public:
@@ -678,6 +733,7 @@ public:
 
 private:
     bool checkAttributes(const QXmlStreamAttributes &attributes, QScxmlCompilerPrivate::ParserState::Kind kind);
+    bool readElement(ParserState::Kind elementKind);
     ParserState &current();
     ParserState &previous();
     bool hasPrevious() const;
@@ -88,6 +88,42 @@ void TheDataModel::evaluateToVoid(QScxmlExecutableContent::EvaluatorId id, bool
    converted to the respective bool or QVariant. And, as the \c this pointer is also captured, you
    can call or access the data model (the \e media attribute in the example above). For the full
    example, see \l {SCXML Media Player}.
+
+   \section1 Typed Data
+
+   Since Qt 6.6, the items of the data model can be given a C++ type with the \c qt:type
+   attribute, where the \c qt prefix is bound to \c{http://theqtcompany.com/scxml/2015/06/}:
+   \code
+<scxml datamodel="cplusplus:TheDataModel:thedatamodel.h" xmlns="http://www.w3.org/2005/07/scxml"
+       xmlns:qt="http://theqtcompany.com/scxml/2015/06/" version="1.0">
+    <datamodel>
+        <data id="counter" qt:type="int" expr="0"/>
+    </datamodel>
+    <state id="counting">
+        <transition event="tick">
+            <assign location="counter" expr="counter + 1"/>
+        </transition>
+    </state>
+</scxml>
+   \endcode
+   The data model class then declares a member of that name and type, and uses the
+   Q_SCXML_TYPED_DATAMODEL macro instead of Q_SCXML_DATAMODEL:
+   \badcode
+class TheDataModel: public QScxmlCppDataModel
+{
+    \Q_OBJECT
+    Q_SCXML_TYPED_DATAMODEL
+
+    int counter = 0;
+};
+   \endcode
+   The Qt SCXML compiler then also generates evaluateAssignment(), evaluateInitialization(),
+   scxmlProperty(), hasScxmlProperty() and setScxmlProperty(). \c <data> initializations and
+   \c <assign> elements targeting a typed item become plain assignments to the member, without
+   converting through QVariant. The property methods give access to the members by name, which is
+   used by \c namelist and \c location attributes, for example in \c <send> and \c <param>.
+   Values are only boxed in a QVariant at that boundary. Assignments to locations that are not
+   typed are handled by the QScxmlCppDataModel implementations, which report failure.
  */
 
 /*!
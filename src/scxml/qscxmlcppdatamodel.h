@@ -14,6 +14,17 @@
         void evaluateToVoid(QScxmlExecutableContent::EvaluatorId id, bool *ok) override final; \
     private:
 
+#define Q_SCXML_TYPED_DATAMODEL \
+    Q_SCXML_DATAMODEL \
+    public: \
+        void evaluateAssignment(QScxmlExecutableContent::EvaluatorId id, bool *ok) override final; \
+        void evaluateInitialization(QScxmlExecutableContent::EvaluatorId id, bool *ok) override final; \
+        QVariant scxmlProperty(const QString &name) const override final; \
+        bool hasScxmlProperty(const QString &name) const override final; \
+        bool setScxmlProperty(const QString &name, const QVariant &value, \
+                              const QString &context) override final; \
+    private:
+
 QT_BEGIN_NAMESPACE
 
 class QScxmlCppDataModelPrivate;
@@ -115,7 +115,8 @@ QScxmlEvent *QScxmlEventBuilder::buildEvent()
         invokeid = stateMachine->sessionId();
     }
 
-    QScxmlEvent *event = new QScxmlEvent;
+    QScxmlEvent *event = stateMachine ? QScxmlStateMachinePrivate::get(stateMachine)->newEvent()
+                                      : new QScxmlEvent;
     event->setName(eventName);
     event->setEventType(eventType);
     event->setData(data);
@@ -229,14 +230,14 @@ void QScxmlEventBuilder::submitError(const QString &type, const QString &msg, co
  */
 QScxmlEvent::QScxmlEvent()
     : d(new QScxmlEventPrivate)
-{ }
+{
+}
 
 /*!
  * Destroys the SCXML event.
  */
 QScxmlEvent::~QScxmlEvent()
 {
-    delete d;
 }
 
 /*!
@@ -266,24 +267,33 @@ QString QScxmlEvent::scxmlType() const
  */
 void QScxmlEvent::clear()
 {
-    *d = QScxmlEventPrivate();
+    if (d->ref.loadRelaxed() == 1)
+        d->clear();
+    else
+        d.reset(new QScxmlEventPrivate);
 }
 
 /*!
  * Assigns \a other to this SCXML event and returns a reference to this SCXML
  * event.
+ *
+ * The contents of the event are implicitly shared, so this does not copy them
+ * until either event is modified.
  */
 QScxmlEvent &QScxmlEvent::operator=(const QScxmlEvent &other)
 {
-    *d = *other.d;
+    d = other.d;
     return *this;
 }
 
 /*!
  * Constructs a copy of \a other.
+ *
+ * The contents of the event are implicitly shared, so this does not copy them
+ * until either event is modified.
  */
 QScxmlEvent::QScxmlEvent(const QScxmlEvent &other)
-    : d(new QScxmlEventPrivate(*other.d))
+    : d(other.d)
 {
 }
 
@@ -315,6 +325,7 @@ QString QScxmlEvent::name() const
  */
 void QScxmlEvent::setName(const QString &name)
 {
+    d.detach();
     d->name = name;
 }
 
@@ -344,6 +355,7 @@ QString QScxmlEvent::sendId() const
  */
 void QScxmlEvent::setSendId(const QString &sendid)
 {
+    d.detach();
     d->sendid = sendid;
 }
 
@@ -371,6 +383,7 @@ QString QScxmlEvent::origin() const
  */
 void QScxmlEvent::setOrigin(const QString &origin)
 {
+    d.detach();
     d->origin = origin;
 }
 
@@ -398,6 +411,7 @@ QString QScxmlEvent::originType() const
  */
 void QScxmlEvent::setOriginType(const QString &origintype)
 {
+    d.detach();
     d->originType = origintype;
 }
 
@@ -422,6 +436,7 @@ QString QScxmlEvent::invokeId() const
  */
 void QScxmlEvent::setInvokeId(const QString &invokeid)
 {
+    d.detach();
     d->invokeId = invokeid;
 }
 
@@ -447,6 +462,7 @@ int QScxmlEvent::delay() const
  */
 void QScxmlEvent::setDelay(int delayInMiliSecs)
 {
+    d.detach();
     d->delayInMiliSecs = delayInMiliSecs;
 }
 /*!
@@ -470,6 +486,7 @@ QScxmlEvent::EventType QScxmlEvent::eventType() const
  */
 void QScxmlEvent::setEventType(const EventType &type)
 {
+    d.detach();
     d->eventType = type;
 }
 
@@ -503,8 +520,10 @@ QVariant QScxmlEvent::data() const
  */
 void QScxmlEvent::setData(const QVariant &data)
 {
-    if (!isErrorEvent())
+    if (!isErrorEvent()) {
+        d.detach();
         d->data = data;
+    }
 }
 
 /*!
@@ -541,8 +560,10 @@ QString QScxmlEvent::errorMessage() const
  */
 void QScxmlEvent::setErrorMessage(const QString &message)
 {
-    if (isErrorEvent())
+    if (isErrorEvent()) {
+        d.detach();
         d->data = message;
+    }
 }
 
 QByteArray QScxmlEventPrivate::debugString(QScxmlEvent *event)
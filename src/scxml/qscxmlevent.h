@@ -6,6 +6,7 @@
 
 #include <QtScxml/qscxmlglobals.h>
 
+#include <QtCore/qshareddata.h>
 #include <QtCore/qstringlist.h>
 #include <QtCore/qvariant.h>
 
@@ -75,7 +76,8 @@ public:
     void setErrorMessage(const QString &message);
 
 private:
-    QScxmlEventPrivate *d;
+    friend class QScxmlEventPrivate;
+    QExplicitlySharedDataPointer<QScxmlEventPrivate> d;
 
 };
 
@@ -23,6 +23,7 @@
 #endif
 
 #include <QtCore/qatomic.h>
+#include <QtCore/qshareddata.h>
 
 QT_BEGIN_NAMESPACE
 
@@ -119,7 +120,7 @@ public:
 };
 #endif // BUILD_QSCXMLC
 
-class QScxmlEventPrivate
+class QScxmlEventPrivate : public QSharedData
 {
 public:
     QScxmlEventPrivate()
@@ -136,7 +137,41 @@ public:
     QString invokeId; // id of the invocation that triggered the child process if this was invoked
     int delayInMiliSecs;
 
+    // Resets all fields to their default values. Unless keepCapacity is false, the memory of
+    // strings that are not shared is kept, so that a recycled event can be filled again without
+    // reallocating.
+    void clear(bool keepCapacity = false)
+    {
+        clearString(name, keepCapacity);
+        eventType = QScxmlEvent::ExternalEvent;
+        data.clear();
+        clearString(sendid, keepCapacity);
+        clearString(origin, keepCapacity);
+        clearString(originType, keepCapacity);
+        clearString(invokeId, keepCapacity);
+        delayInMiliSecs = 0;
+    }
+
+    // Prepares an event to be handed out again by an event pool.
+    static void reset(QScxmlEvent *event)
+    {
+        QExplicitlySharedDataPointer<QScxmlEventPrivate> &d = event->d;
+        if (d->ref.loadRelaxed() == 1)
+            d->clear(true);
+        else
+            d.reset(new QScxmlEventPrivate);
+    }
+
     static QByteArray debugString(QScxmlEvent *event);
+
+private:
+    static void clearString(QString &str, bool keepCapacity)
+    {
+        if (keepCapacity && str.isDetached())
+            str.truncate(0);
+        else
+            str = QString();
+    }
 };
 
 QT_END_NAMESPACE
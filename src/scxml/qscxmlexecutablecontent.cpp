@@ -6,6 +6,10 @@
 #include "qscxmlcompiler_p.h"
 #include "qscxmlevent_p.h"
 
+#ifndef BUILD_QSCXMLC
+#include "qscxmlstatemachine_p.h"
+#endif // BUILD_QSCXMLC
+
 QT_BEGIN_NAMESPACE
 
 using namespace QScxmlExecutableContent;
@@ -386,11 +390,7 @@ const InstructionId *QScxmlExecutionEngine::step(const InstructionId *ip, bool *
         qCDebug(qscxmlLog) << stateMachine << "Executing raise step";
         const Raise *raise = reinterpret_cast<const Raise *>(instr);
         ip += raise->size();
-        auto name = tableData->string(raise->event);
-        auto event = new QScxmlEvent;
-        event->setName(name);
-        event->setEventType(QScxmlEvent::InternalEvent);
-        stateMachine->submitEvent(event);
+        QScxmlStateMachinePrivate::get(stateMachine)->raiseInternalEvent(raise->event);
         return ip;
     }
 
@@ -405,13 +405,7 @@ const InstructionId *QScxmlExecutionEngine::step(const InstructionId *ip, bool *
                 qCWarning(qscxmlLog) << stateMachine << "Could not evaluate <log> expr to string.";
         }
 
-        const QString label = tableData->string(log->label);
-        qCDebug(scxmlLog) << label << ":" << str;
-        QMetaObject::invokeMethod(stateMachine,
-                                  "log",
-                                  Qt::QueuedConnection,
-                                  Q_ARG(QString, label),
-                                  Q_ARG(QString, str));
+        QScxmlStateMachinePrivate::get(stateMachine)->log(tableData->string(log->label), str);
         return ip;
     }
 
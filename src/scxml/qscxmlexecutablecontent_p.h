@@ -280,10 +280,25 @@ struct StateTable {
     int stateOffset, stateCount;
     int transitionOffset, transitionCount;
     int arrayOffset, arraySize;
+    enum: int {
+        NoFlags = 0x0,
+        EventVariableUsed = 0x1 // some expression or script in the data model reads _event
+    };
+    int flags;
+    int ecmaScriptModule; // string id of the evaluators pre-compiled by qscxmlc, or -1
+    int transitionPaths; // offset into arrays, or -1 if the paths were not precomputed
 
     enum { terminator = 0xc0ff33 };
     enum { InvalidIndex = -1 };
 
+    // The path of a transition that neither targets nor enters a history state does not depend on
+    // the configuration, and can be precomputed. Its array holds the transition domain, the last
+    // state that descends from the domain, and then the states to enter in entry order, each
+    // followed by the instructions of its initial transition if it is entered by default, or -1.
+    // The descendants of the domain are numbered consecutively, so the states to exit are the
+    // active ones between the domain and its last descendant.
+    enum { PathDomain = 0, PathLastDescendant = 1, PathEntries = 2 };
+
     struct State {
         int name;
         int parent;
@@ -424,6 +439,9 @@ struct StateTable {
         , stateOffset(InvalidIndex), stateCount(InvalidIndex)
         , transitionOffset(InvalidIndex), transitionCount(InvalidIndex)
         , arrayOffset(InvalidIndex), arraySize(InvalidIndex)
+        , flags(NoFlags)
+        , ecmaScriptModule(InvalidIndex)
+        , transitionPaths(InvalidIndex)
     {}
 
     const State &state(int idx) const
@@ -453,6 +471,13 @@ struct StateTable {
             return Array(nullptr);
         }
     }
+
+    const Array transitionPath(int transitionIdx) const
+    {
+        if (transitionPaths == InvalidIndex)
+            return Array(nullptr);
+        return array(array(transitionPaths)[transitionIdx]);
+    }
 };
 
 #if defined(Q_CC_MSVC) || defined(Q_CC_GNU)
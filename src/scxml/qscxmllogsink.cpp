@@ -0,0 +1,67 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#include "qscxmllogsink.h"
+
+QT_BEGIN_NAMESPACE
+
+/*!
+ * \class QScxmlLogSink
+ * \brief The QScxmlLogSink class receives the output of \c <log> elements in
+ * batches.
+ * \since 6.6
+ * \inmodule QtScxml
+ *
+ * The QScxmlStateMachine::log() signal is emitted through a queued invocation
+ * for every \c <log> element that is executed. State machines producing a lot
+ * of diagnostic output can instead install a log sink with
+ * QScxmlStateMachine::setLogSink(). The state machine collects the records
+ * while it processes events, and hands them over to the sink in one call at
+ * the end of each macrostep.
+ *
+ * \sa QScxmlStateMachine::log()
+ */
+
+/*!
+ * \class QScxmlLogSink::Record
+ * \brief The Record struct describes a single executed \c <log> element.
+ * \inmodule QtScxml
+ */
+
+/*!
+ * \variable QScxmlLogSink::Record::label
+ * \brief The label attribute of the \c <log> element.
+ */
+
+/*!
+ * \variable QScxmlLogSink::Record::message
+ * \brief The evaluated expr attribute of the \c <log> element.
+ */
+
+/*!
+ * \variable QScxmlLogSink::Record::timestamp
+ * \brief The time at which the \c <log> element was executed, in milliseconds
+ * since the epoch.
+ */
+
+/*!
+ * Creates a new log sink.
+ */
+QScxmlLogSink::QScxmlLogSink()
+{}
+
+/*!
+ * Destroys the log sink. The sink has to be removed from any state machine it
+ * is installed on before it is destroyed.
+ */
+QScxmlLogSink::~QScxmlLogSink()
+{}
+
+/*!
+ * \fn void QScxmlLogSink::log(const QList<Record> &records)
+ *
+ * Receives the \a records collected by a state machine since the last call,
+ * in the order in which the \c <log> elements were executed.
+ */
+
+QT_END_NAMESPACE
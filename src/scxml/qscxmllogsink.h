@@ -0,0 +1,35 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR LGPL-3.0-only OR GPL-2.0-only OR GPL-3.0-only
+
+#ifndef QSCXMLLOGSINK_H
+#define QSCXMLLOGSINK_H
+
+#include <QtScxml/qscxmlglobals.h>
+#include <QtCore/qlist.h>
+#include <QtCore/qstring.h>
+
+QT_BEGIN_NAMESPACE
+
+class Q_SCXML_EXPORT QScxmlLogSink
+{
+    Q_DISABLE_COPY(QScxmlLogSink)
+
+public:
+    struct Record
+    {
+        QString label;
+        QString message;
+        qint64 timestamp = 0;
+    };
+
+    QScxmlLogSink();
+    virtual ~QScxmlLogSink();
+
+    virtual void log(const QList<Record> &records) = 0;
+};
+
+Q_DECLARE_TYPEINFO(QScxmlLogSink::Record, Q_RELOCATABLE_TYPE);
+
+QT_END_NAMESPACE
+
+#endif // QSCXMLLOGSINK_H
@@ -13,13 +13,11 @@ class QScxmlNullDataModelPrivate : public QScxmlDataModelPrivate
 {
     Q_DECLARE_PUBLIC(QScxmlNullDataModel)
 
-    struct ResolvedEvaluatorInfo {
-        bool error;
-        QString str;
-
-        ResolvedEvaluatorInfo()
-            : error(false)
-        {}
+    // Besides the state indexes (or StateTable::InvalidIndex for unknown states), the resolved
+    // evaluators can hold these markers:
+    enum : int {
+        Unresolved = -3,
+        Unsupported = -2
     };
 
 public:
@@ -28,52 +26,76 @@ public:
         Q_Q(QScxmlNullDataModel);
         Q_ASSERT(ok);
 
-        ResolvedEvaluatorInfo info;
-        Resolved::const_iterator it = resolved.find(id);
-        if (it == resolved.end()) {
-            info = prepare(id);
-        } else {
-            info = it.value();
+        int stateIndex = resolvedStateIndex(id);
+        if (stateIndex == Unresolved) {
+            stateIndex = prepare(id);
+            if (size_t(id) >= resolved.size())
+                resolved.resize(size_t(id) + 1, Unresolved);
+            resolved[size_t(id)] = stateIndex;
         }
 
-        if (info.error) {
+        auto smp = QScxmlStateMachinePrivate::get(q->stateMachine());
+        if (stateIndex == Unsupported) {
             *ok = false;
-            QScxmlStateMachinePrivate::get(q->stateMachine())->submitError(QStringLiteral("error.execution"), info.str);
+            smp->submitError(QStringLiteral("error.execution"), errorMessage(id));
             return false;
         }
 
         *ok = true;
-        return q->stateMachine()->isActive(info.str);
+        return smp->isStateActive(stateIndex);
     }
 
-    ResolvedEvaluatorInfo prepare(QScxmlExecutableContent::EvaluatorId id)
+    // Resolves the conditions of all transitions up front, so that evaluating them is an array
+    // lookup and a bit test. Conditions in <if> are resolved on first use.
+    void resolveTransitionConditions()
     {
-        auto td = m_stateMachine->tableData();
-        const QScxmlExecutableContent::EvaluatorInfo &info = td->evaluatorInfo(id);
-        QString expr = td->string(info.expr);
-        for (int i = 0; i < expr.size(); ) {
-            QChar ch = expr.at(i);
-            if (ch.isSpace()) {
-                expr.remove(i, 1);
-            } else {
-                ++i;
-            }
-        }
+        resolved.clear();
+        const auto *stateTable = QScxmlStateMachinePrivate::get(m_stateMachine)->m_stateTable;
+        if (!stateTable)
+            return;
 
-        ResolvedEvaluatorInfo resolved;
-        if (expr.startsWith(QStringLiteral("In(")) && expr.endsWith(QLatin1Char(')'))) {
-            resolved.error = false;
-            resolved.str =  expr.mid(3, expr.size() - 4);
-        } else {
-            resolved.error = true;
-            resolved.str =  QStringLiteral("%1 in %2").arg(expr, td->string(info.context));
+        for (int i = 0; i < stateTable->transitionCount; ++i) {
+            const QScxmlExecutableContent::EvaluatorId condition =
+                    stateTable->transition(i).condition;
+            if (condition < 0)
+                continue;
+            if (size_t(condition) >= resolved.size())
+                resolved.resize(size_t(condition) + 1, Unresolved);
+            if (resolved[size_t(condition)] == Unresolved)
+                resolved[size_t(condition)] = prepare(condition);
         }
-        return resolved;
     }
 
 private:
-    typedef QHash<QScxmlExecutableContent::EvaluatorId, ResolvedEvaluatorInfo> Resolved;
-    Resolved resolved;
+    int resolvedStateIndex(QScxmlExecutableContent::EvaluatorId id) const
+    { return size_t(id) < resolved.size() ? resolved[size_t(id)] : int(Unresolved); }
+
+    QString strippedExpression(QScxmlExecutableContent::EvaluatorId id) const
+    {
+        auto td = m_stateMachine->tableData();
+        QString expr = td->string(td->evaluatorInfo(id).expr);
+        expr.removeIf([](QChar ch) { return ch.isSpace(); });
+        return expr;
+    }
+
+    int prepare(QScxmlExecutableContent::EvaluatorId id) const
+    {
+        const QString expr = strippedExpression(id);
+        if (!expr.startsWith(QStringLiteral("In(")) || !expr.endsWith(QLatin1Char(')')))
+            return Unsupported;
+
+        return QScxmlStateMachinePrivate::get(m_stateMachine)->stateIndexForName(
+                    expr.mid(3, expr.size() - 4));
+    }
+
+    QString errorMessage(QScxmlExecutableContent::EvaluatorId id) const
+    {
+        auto td = m_stateMachine->tableData();
+        return QStringLiteral("%1 in %2").arg(strippedExpression(id),
+                                              td->string(td->evaluatorInfo(id).context));
+    }
+
+    std::vector<int> resolved;
 };
 
 /*!
@@ -111,8 +133,10 @@ QScxmlNullDataModel::~QScxmlNullDataModel()
  */
 bool QScxmlNullDataModel::setup(const QVariantMap &initialDataValues)
 {
+    Q_D(QScxmlNullDataModel);
     Q_UNUSED(initialDataValues);
 
+    d->resolveTransitionConditions();
     return true;
 }
 
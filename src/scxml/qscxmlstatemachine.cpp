@@ -6,7 +6,9 @@
 #include "qscxmlevent_p.h"
 #include "qscxmlinvokableservice.h"
 #include "qscxmldatamodel_p.h"
+#include "qscxmlcompiledchart_p.h"
 
+#include <qdatetime.h>
 #include <qfile.h>
 #include <qhash.h>
 #include <qloggingcategory.h>
@@ -499,10 +501,10 @@ void QScxmlStateMachinePrivate::routeEvent(QScxmlEvent *event)
                 qCDebug(qscxmlLog) << q << "routing event" << event->name()
                                    << "from" << q->name()
                                    << "to child" << service->id();
-                service->postEvent(new QScxmlEvent(*event));
+                service->postEvent(copyEvent(*event));
             }
         }
-        delete event;
+        recycleEvent(event);
     } else {
         postEvent(event);
     }
@@ -536,7 +538,7 @@ void QScxmlStateMachinePrivate::postEvent(QScxmlEvent *event)
                 qCDebug(qscxmlLog) << q << "auto-forwarding event" << event->name()
                                    << "from" << q->name()
                                    << "to child" << service->id();
-                service->postEvent(new QScxmlEvent(*event));
+                service->postEvent(copyEvent(*event));
             }
         }
     }
@@ -594,6 +596,82 @@ void QScxmlStateMachinePrivate::submitError(const QString &type, const QString &
     q->submitEvent(QScxmlEventBuilder::errorEvent(q, type, message, sendId));
 }
 
+/*!
+ * Enqueues an internal event called \a eventName, as done by \c <raise>.
+ *
+ * Raised events never leave the state machine, so they are not routed, not auto-forwarded to
+ * invoked services, and do not need the event loop to be woken up while a macrostep is in
+ * progress. The event object is taken from the event pool, and its name is interned per string
+ * id.
+ */
+void QScxmlStateMachinePrivate::raiseInternalEvent(QScxmlExecutableContent::StringId eventName)
+{
+    Q_Q(QScxmlStateMachine);
+
+    const size_t nameIndex = size_t(eventName);
+    if (nameIndex >= m_internedEventNames.size())
+        m_internedEventNames.resize(nameIndex + 1);
+    QString &name = m_internedEventNames[nameIndex];
+    if (name.isNull())
+        name = m_tableData.value()->string(eventName);
+
+    QScxmlEvent *event = newEvent();
+    event->setName(name);
+    event->setEventType(QScxmlEvent::InternalEvent);
+
+    qCDebug(qscxmlLog) << q << "raising internal event" << name;
+    m_internalQueue.enqueue(event);
+
+    // <raise> can also run outside of a macrostep, e.g. in the finalize content of an invoke.
+    if (!m_isProcessingEvents)
+        m_eventLoopHook.queueProcessEvents();
+}
+
+QScxmlEvent *QScxmlStateMachinePrivate::copyEvent(const QScxmlEvent &event)
+{
+    QScxmlEvent *copy = newEvent();
+    *copy = event;
+    return copy;
+}
+
+/*!
+ * Handles the output of a \c <log> element with the given \a label and \a message.
+ *
+ * The log() signal is only queued if something is connected to it. If a log sink is installed,
+ * the record is collected and handed to the sink at the end of the current macrostep.
+ */
+void QScxmlStateMachinePrivate::log(const QString &label, const QString &message)
+{
+    Q_Q(QScxmlStateMachine);
+    qCDebug(scxmlLog) << label << ":" << message;
+
+    if (m_logSink) {
+        m_logRecords.append({ label, message, QDateTime::currentMSecsSinceEpoch() });
+        if (!m_isProcessingEvents)
+            flushLogRecords();
+    }
+
+    static const int logSignalIndex = QMetaObjectPrivate::signalIndex(
+                QMetaMethod::fromSignal(&QScxmlStateMachine::log));
+    if (isSignalConnected(logSignalIndex)) {
+        QMetaObject::invokeMethod(q,
+                                  "log",
+                                  Qt::QueuedConnection,
+                                  Q_ARG(QString, label),
+                                  Q_ARG(QString, message));
+    }
+}
+
+void QScxmlStateMachinePrivate::flushLogRecords()
+{
+    if (m_logRecords.isEmpty())
+        return;
+
+    const QList<QScxmlLogSink::Record> records = std::exchange(m_logRecords, {});
+    if (m_logSink)
+        m_logSink->log(records);
+}
+
 void QScxmlStateMachinePrivate::start()
 {
     Q_Q(QScxmlStateMachine);
@@ -651,7 +729,7 @@ void QScxmlStateMachinePrivate::processEvents()
                 microstep(enabledTransitions);
             }
             resetEvent();
-            delete event;
+            recycleEvent(event);
         } else if (!m_externalQueue.isEmpty()) {
             auto event = m_externalQueue.dequeue();
             setEvent(event);
@@ -660,7 +738,7 @@ void QScxmlStateMachinePrivate::processEvents()
                 microstep(enabledTransitions);
             }
             resetEvent();
-            delete event;
+            recycleEvent(event);
         } else {
             // nothing to do, so:
             break;
@@ -682,6 +760,7 @@ void QScxmlStateMachinePrivate::processEvents()
         emit q->finished();
     }
 
+    flushLogRecords();
     m_isProcessingEvents = false;
 }
 
@@ -693,7 +772,8 @@ void QScxmlStateMachinePrivate::setEvent(QScxmlEvent *event)
 
 void QScxmlStateMachinePrivate::resetEvent()
 {
-    m_dataModel.value()->setScxmlEvent(QScxmlEvent());
+    static const QScxmlEvent noEvent;
+    m_dataModel.value()->setScxmlEvent(noEvent);
 }
 
 void QScxmlStateMachinePrivate::emitStateActive(int stateIndex, bool active)
@@ -734,6 +814,7 @@ void QScxmlStateMachinePrivate::updateMetaCache()
     // and invalid states, effectively skipping them
     m_stateIndexToSignalIndex.clear();
     m_stateNameToSignalIndex.clear();
+    m_stateIndexForName.clear();
 
     if (!m_tableData.value())
         return;
@@ -745,10 +826,11 @@ void QScxmlStateMachinePrivate::updateMetaCache()
     const int methodOffset = QMetaObjectPrivate::signalOffset(m_metaObject);
     for (int i = 0; i < m_stateTable->stateCount; ++i) {
         const auto &s = m_stateTable->state(i);
+        if (s.name != QScxmlExecutableContent::NoString)
+            m_stateIndexForName.insert(string(s.name), i);
         if (!s.isHistoryState() && s.type != StateTable::State::Invalid) {
             m_stateIndexToSignalIndex.insert(i, signalIndex);
-            m_stateNameToSignalIndex.insert(m_tableData.value()->string(s.name),
-                                            signalIndex + methodOffset);
+            m_stateNameToSignalIndex.insert(string(s.name), signalIndex + methodOffset);
 
             ++signalIndex;
         }
@@ -758,11 +840,27 @@ void QScxmlStateMachinePrivate::updateMetaCache()
 QStringList QScxmlStateMachinePrivate::stateNames(const std::vector<int> &stateIndexes) const
 {
     QStringList names;
+    names.reserve(qsizetype(stateIndexes.size()));
     for (int idx : stateIndexes)
-        names.append(m_tableData.value()->string(m_stateTable->state(idx).name));
+        names.append(string(m_stateTable->state(idx).name));
     return names;
 }
 
+const QString &QScxmlStateMachinePrivate::string(QScxmlExecutableContent::StringId id) const
+{
+    static const QString noString;
+    if (id == QScxmlExecutableContent::NoString)
+        return noString;
+
+    Q_ASSERT(id >= 0);
+    if (size_t(id) >= m_strings.size())
+        m_strings.resize(size_t(id) + 1);
+    QString &cached = m_strings[size_t(id)];
+    if (cached.isNull())
+        cached = m_tableData.value()->string(id);
+    return cached;
+}
+
 std::vector<int> QScxmlStateMachinePrivate::historyStates(int stateIdx) const {
     const StateTable::Array kids = m_stateTable->array(m_stateTable->state(stateIdx).childStates);
     std::vector<int> res;
@@ -804,7 +902,7 @@ void QScxmlStateMachinePrivate::returnDoneEvent(QScxmlExecutableContent::Contain
 
     m_executionEngine->execute(doneData, QVariant());
     if (m_isInvoked) {
-        auto e = new QScxmlEvent;
+        auto e = newEvent();
         e->setName(QStringLiteral("done.invoke.") + q->sessionId());
         e->setInvokeId(q->sessionId());
         QScxmlStateMachinePrivate::get(m_parentStateMachine)->postEvent(e);
@@ -817,12 +915,12 @@ bool QScxmlStateMachinePrivate::nameMatch(const StateTable::Array &patterns,
     const QString eventName = event->name();
     bool selected = false;
     for (int eventSelectorIter = 0; eventSelectorIter < patterns.size(); ++eventSelectorIter) {
-        QString eventStr = m_tableData.value()->string(patterns[eventSelectorIter]);
-        if (eventStr == QStringLiteral("*")) {
+        QStringView eventStr = stringView(patterns[eventSelectorIter]);
+        if (eventStr == QLatin1String("*")) {
             selected = true;
             break;
         }
-        if (eventStr.endsWith(QStringLiteral(".*")))
+        if (eventStr.endsWith(QLatin1String(".*")))
             eventStr.chop(2);
         if (eventName.startsWith(eventStr)) {
             QChar nextC = QLatin1Char('.');
@@ -837,6 +935,27 @@ bool QScxmlStateMachinePrivate::nameMatch(const StateTable::Array &patterns,
     return selected;
 }
 
+bool QScxmlStateMachinePrivate::evaluateCondition(
+        QScxmlExecutableContent::EvaluatorId condition) const
+{
+    bool ok = false;
+    QScxmlDataModel *dataModel = m_dataModel.value();
+    if (m_useBoolEvaluators && condition < m_boolEvaluatorCount) {
+        // Data models generated with an evaluator table are called directly, without going
+        // through the virtual evaluateToBool() and its switch.
+        if (auto evaluator = m_boolEvaluators[condition])
+            return evaluator(dataModel, &ok) && ok;
+    }
+    return dataModel->evaluateToBool(condition, &ok) && ok;
+}
+
+void QScxmlStateMachinePrivate::updateBoolEvaluators()
+{
+    QScxmlDataModel *dataModel = m_dataModel.value();
+    m_useBoolEvaluators = m_boolEvaluators && dataModel
+            && m_boolEvaluatorDataModelType->cast(dataModel);
+}
+
 void QScxmlStateMachinePrivate::selectTransitions(OrderedSet &enabledTransitions,
                                                   const std::vector<int> &configInDocumentOrder,
                                                   QScxmlEvent *event) const
@@ -877,8 +996,7 @@ void QScxmlStateMachinePrivate::selectTransitions(OrderedSet &enabledTransitions
                             if (t.condition == -1) {
                                 enabled = true;
                             } else {
-                                bool ok = false;
-                                enabled = m_dataModel.value()->evaluateToBool(t.condition, &ok) && ok;
+                                enabled = evaluateCondition(t.condition);
                             }
                         }
                     } else {
@@ -886,8 +1004,7 @@ void QScxmlStateMachinePrivate::selectTransitions(OrderedSet &enabledTransitions
                             if (t.condition == -1) {
                                 enabled = true;
                             } else {
-                                bool ok = false;
-                                enabled = m_dataModel.value()->evaluateToBool(t.condition, &ok) && ok;
+                                enabled = evaluateCondition(t.condition);
                             }
                         }
                     }
@@ -1059,6 +1176,7 @@ void QScxmlStateMachinePrivate::exitStates(const OrderedSet &enabledTransitions)
         if (state.exitInstructions != StateTable::InvalidIndex)
             m_executionEngine->execute(state.exitInstructions);
         m_configuration.remove(s);
+        m_activeStates[size_t(s)] = false;
         emitStateActive(s, false);
         removeService(s);
     }
@@ -1078,10 +1196,20 @@ void QScxmlStateMachinePrivate::computeExitSet(const OrderedSet &enabledTransiti
         if (transition.targets == StateTable::InvalidIndex) {
             // nothing to do here: there is no exit set
         } else {
-            const int domain = getTransitionDomain(t);
-            for (int s : m_configuration) {
-                if (isDescendant(s, domain))
-                    statesToExit.add(s);
+            const StateTable::Array path = m_stateTable->transitionPath(t);
+            if (path.isValid()) {
+                const int domain = path[StateTable::PathDomain];
+                const int lastDescendant = path[StateTable::PathLastDescendant];
+                for (int s : m_configuration) {
+                    if (s > domain && s <= lastDescendant)
+                        statesToExit.add(s);
+                }
+            } else {
+                const int domain = getTransitionDomain(t);
+                for (int s : m_configuration) {
+                    if (isDescendant(s, domain))
+                        statesToExit.add(s);
+                }
             }
         }
     }
@@ -1106,16 +1234,43 @@ void QScxmlStateMachinePrivate::enterStates(const OrderedSet &enabledTransitions
 {
     Q_Q(QScxmlStateMachine);
 
-    OrderedSet statesToEnter, statesForDefaultEntry;
+    std::vector<int> sortedStates;
+    std::vector<int> defaultEntryInstructions;
     HistoryContent defaultHistoryContent;
-    computeEntrySet(enabledTransitions, &statesToEnter, &statesForDefaultEntry,
-                    &defaultHistoryContent);
-    auto sortedStates = statesToEnter.takeList();
-    std::sort(sortedStates.begin(), sortedStates.end());
+    const StateTable::Array path = enabledTransitions.list().size() == 1
+            ? m_stateTable->transitionPath(*enabledTransitions.begin())
+            : StateTable::Array(nullptr);
+    if (path.isValid()) {
+        const int entryCount = (path.size() - StateTable::PathEntries) / 2;
+        sortedStates.reserve(size_t(entryCount));
+        defaultEntryInstructions.reserve(size_t(entryCount));
+        for (int i = StateTable::PathEntries; i < path.size(); i += 2) {
+            sortedStates.push_back(path[i]);
+            defaultEntryInstructions.push_back(path[i + 1]);
+        }
+    } else {
+        OrderedSet statesToEnter, statesForDefaultEntry;
+        computeEntrySet(enabledTransitions, &statesToEnter, &statesForDefaultEntry,
+                        &defaultHistoryContent);
+        sortedStates = statesToEnter.takeList();
+        std::sort(sortedStates.begin(), sortedStates.end());
+        defaultEntryInstructions.reserve(sortedStates.size());
+        for (int s : sortedStates) {
+            int instructions = StateTable::InvalidIndex;
+            if (statesForDefaultEntry.contains(s)) {
+                const auto &state = m_stateTable->state(s);
+                instructions = m_stateTable->transition(state.initialTransition)
+                        .transitionInstructions;
+            }
+            defaultEntryInstructions.push_back(instructions);
+        }
+    }
     qCDebug(qscxmlLog) << q_func() << "entering states" << stateNames(sortedStates);
-    for (int s : sortedStates) {
+    for (size_t i = 0, ei = sortedStates.size(); i != ei; ++i) {
+        const int s = sortedStates[i];
         const auto &state = m_stateTable->state(s);
         m_configuration.add(s);
+        m_activeStates[size_t(s)] = true;
         if (state.serviceFactoryIds != StateTable::InvalidIndex)
             m_statesToInvoke.insert(s);
         if (m_stateTable->binding == StateTable::LateBinding && m_isFirstStateEntry[s]) {
@@ -1125,11 +1280,8 @@ void QScxmlStateMachinePrivate::enterStates(const OrderedSet &enabledTransitions
         }
         if (state.entryInstructions != StateTable::InvalidIndex)
             m_executionEngine->execute(state.entryInstructions);
-        if (statesForDefaultEntry.contains(s)) {
-            const auto &initialTransition = m_stateTable->transition(state.initialTransition);
-            if (initialTransition.transitionInstructions != StateTable::InvalidIndex)
-                m_executionEngine->execute(initialTransition.transitionInstructions);
-        }
+        if (defaultEntryInstructions[i] != StateTable::InvalidIndex)
+            m_executionEngine->execute(defaultEntryInstructions[i]);
         const int dhc = defaultHistoryContent.value(s);
         if (dhc != StateTable::InvalidIndex)
             m_executionEngine->execute(dhc);
@@ -1146,7 +1298,7 @@ void QScxmlStateMachinePrivate::enterStates(const OrderedSet &enabledTransitions
                     const auto &grandParent = m_stateTable->state(parent.parent);
                     if (grandParent.isParallel()) {
                         if (allInFinalStates(getChildStates(grandParent))) {
-                            auto e = new QScxmlEvent;
+                            auto e = newEvent();
                             e->setEventType(QScxmlEvent::InternalEvent);
                             e->setName(QStringLiteral("done.state.")
                                        + m_tableData.value()->string(grandParent.name));
@@ -1458,6 +1610,17 @@ QScxmlStateMachine *QScxmlStateMachine::fromFile(const QString &fileName)
         return stateMachine;
     }
 
+    // The document is parsed from the mapped file. This is faster than reading it in chunks
+    // through the QIODevice, and the mapping is only needed until the compiler is done with it.
+    const qint64 size = scxmlFile.size();
+    if (uchar *mapped = size > 0 ? scxmlFile.map(0, size) : nullptr) {
+        QScxmlStateMachine *stateMachine = fromData(
+                QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), size), fileName);
+        scxmlFile.unmap(mapped);
+        scxmlFile.close();
+        return stateMachine;
+    }
+
     QScxmlStateMachine *stateMachine = fromData(&scxmlFile, fileName);
     scxmlFile.close();
     return stateMachine;
@@ -1480,6 +1643,60 @@ QScxmlStateMachine *QScxmlStateMachine::fromData(QIODevice *data, const QString
     return compiler.compile();
 }
 
+/*!
+ * \since 6.6
+ * \overload
+ *
+ * Creates a state machine from the SCXML document held in the UTF-8 encoded byte array
+ * specified by \a data. This avoids the overhead of reading the document through a QIODevice
+ * when it is already in memory. The document is parsed before this method returns, so \a data
+ * may also refer to memory that is only valid for the duration of the call, as with
+ * QByteArray::fromRawData().
+ *
+ * This method will always return a state machine. If errors occur while reading the SCXML file,
+ * \a fileName, the state machine cannot be started. The errors can be retrieved by calling the
+ * parseErrors() method.
+ *
+ * \sa fromFile(), parseErrors()
+ */
+QScxmlStateMachine *QScxmlStateMachine::fromData(const QByteArray &data, const QString &fileName)
+{
+    QXmlStreamReader xmlReader(data);
+    QScxmlCompiler compiler(&xmlReader);
+    compiler.setFileName(fileName);
+    return compiler.compile();
+}
+
+/*!
+ * \since 6.6
+ *
+ * Creates a state machine from the compiled chart file specified by \a fileName. Compiled
+ * charts are written by \l{Qt SCXML Compiler (qscxmlc)}{qscxmlc} with the
+ * \c{--compiled-chart} option. They contain the same tables as the C++ classes generated by
+ * qscxmlc, and they are memory mapped instead of being parsed, so that large state machines can
+ * be instantiated quickly without compiling them into the application. Only state machines
+ * that use the null or the ECMAScript data model can be stored in compiled charts.
+ *
+ * This method will always return a state machine. If the file cannot be read, or if it is not
+ * a compiled chart for this version of Qt SCXML, the state machine cannot be started. The errors
+ * can be retrieved by calling the parseErrors() method.
+ *
+ * \sa fromFile(), parseErrors()
+ */
+QScxmlStateMachine *QScxmlStateMachine::fromCompiledFile(const QString &fileName)
+{
+    QString error;
+    const auto file = QScxmlInternal::CompiledChartFile::open(fileName, &error);
+    if (!file) {
+        auto stateMachine = new QScxmlStateMachine(&QScxmlStateMachine::staticMetaObject);
+        QScxmlError err(fileName, 0, 0, error);
+        QScxmlStateMachinePrivate::get(stateMachine)->parserData()->m_errors.append(err);
+        return stateMachine;
+    }
+
+    return QScxmlInternal::instantiateCompiledChart(file, 0);
+}
+
 QList<QScxmlError> QScxmlStateMachine::parseErrors() const
 {
     Q_D(const QScxmlStateMachine);
@@ -1715,6 +1932,7 @@ void QScxmlStateMachine::setDataModel(QScxmlDataModel *model)
         // as the later attempts are ignored (removed when value is set below)
         d->m_dataModel = model;
         model->setStateMachine(this);
+        d->updateBoolEvaluators();
         d->m_dataModel.notify();
         emit dataModelChanged(model);
     }
@@ -1772,12 +1990,14 @@ void QScxmlStateMachine::setTableData(QScxmlTableData *tableData)
     }
 
     d->m_tableData = tableData;
+    d->m_strings.clear();
     if (tableData) {
         d->m_stateTable = reinterpret_cast<const QScxmlExecutableContent::StateTable *>(
                     tableData->stateMachineTable());
         if (objectName().isEmpty()) {
             setObjectName(tableData->name());
         }
+        d->m_activeStates.assign(size_t(d->m_stateTable->stateCount), false);
         if (d->m_stateTable->maxServiceId != QScxmlExecutableContent::StateTable::InvalidIndex) {
             const size_t serviceCount = size_t(d->m_stateTable->maxServiceId + 1);
             d->m_invokedServices.resize(serviceCount, { -1, nullptr, QString() });
@@ -1793,6 +2013,7 @@ void QScxmlStateMachine::setTableData(QScxmlTableData *tableData)
                 == QScxmlExecutableContent::StateTable::terminator);
     }
 
+    d->m_internedEventNames.clear();
     d->updateMetaCache();
 
     d->m_tableData.notify();
@@ -1805,6 +2026,42 @@ QBindable<QScxmlTableData*> QScxmlStateMachine::bindableTableData()
     return &d->m_tableData;
 }
 
+/*!
+  \since 6.6
+
+  Returns the log sink that receives the output of \c <log> elements, or \c nullptr if no
+  log sink is installed.
+
+  \sa setLogSink()
+ */
+QScxmlLogSink *QScxmlStateMachine::logSink() const
+{
+    Q_D(const QScxmlStateMachine);
+    return d->m_logSink;
+}
+
+/*!
+  \since 6.6
+
+  Installs \a sink to receive the output of \c <log> elements. The records are collected while
+  the state machine processes events and are passed to the sink in one batch at the end of each
+  macrostep. The state machine does not take ownership of \a sink. Passing \c nullptr removes
+  the current sink.
+
+  The log() signal is emitted independently of the log sink.
+
+  \sa logSink(), log()
+ */
+void QScxmlStateMachine::setLogSink(QScxmlLogSink *sink)
+{
+    Q_D(QScxmlStateMachine);
+    if (d->m_logSink == sink)
+        return;
+
+    d->flushLogRecords();
+    d->m_logSink = sink;
+}
+
 /*!
     \qmlmethod ScxmlStateMachine::stateNames(bool compress)
 
@@ -1841,7 +2098,7 @@ QStringList QScxmlStateMachine::stateNames(bool compress) const
     for (int i = 0; i < d->m_stateTable->stateCount; ++i) {
         const auto &state = d->m_stateTable->state(i);
         if (!compress || state.isAtomic())
-            names.append(d->m_tableData.value()->string(state.name));
+            names.append(d->string(state.name));
     }
     return names;
 }
@@ -1872,7 +2129,7 @@ QStringList QScxmlStateMachine::activeStateNames(bool compress) const
     for (int stateIdx : d->m_configuration) {
         const auto &state = d->m_stateTable->state(stateIdx);
         if (state.isAtomic() || !compress)
-            result.append(d->m_tableData.value()->string(state.name));
+            result.append(d->string(state.name));
     }
     return result;
 }
@@ -1890,14 +2147,7 @@ QStringList QScxmlStateMachine::activeStateNames(bool compress) const
 bool QScxmlStateMachine::isActive(const QString &scxmlStateName) const
 {
     Q_D(const QScxmlStateMachine);
-
-    for (int stateIndex : d->m_configuration) {
-        const auto &state = d->m_stateTable->state(stateIndex);
-        if (d->m_tableData.value()->string(state.name) == scxmlStateName)
-            return true;
-    }
-
-    return false;
+    return d->isStateActive(d->stateIndexForName(scxmlStateName));
 }
 
 QMetaObject::Connection QScxmlStateMachine::connectToStateImpl(const QString &scxmlStateName,
@@ -2111,7 +2361,8 @@ void QScxmlStateMachine::submitEvent(QScxmlEvent *event)
  */
 void QScxmlStateMachine::submitEvent(const QString &eventName)
 {
-    QScxmlEvent *e = new QScxmlEvent;
+    Q_D(QScxmlStateMachine);
+    QScxmlEvent *e = d->newEvent();
     e->setName(eventName);
     e->setEventType(QScxmlEvent::ExternalEvent);
     submitEvent(e);
@@ -2129,7 +2380,8 @@ void QScxmlStateMachine::submitEvent(const QString &eventName)
  */
 void QScxmlStateMachine::submitEvent(const QString &eventName, const QVariant &data)
 {
-    QScxmlEvent *e = new QScxmlEvent;
+    Q_D(QScxmlStateMachine);
+    QScxmlEvent *e = d->newEvent();
     e->setName(eventName);
     e->setEventType(QScxmlEvent::ExternalEvent);
     e->setData(data);
@@ -2368,7 +2620,37 @@ bool QScxmlStateMachine::isActive(int stateIndex) const
     // index of the compiled metaobject (which is same as its mapped signal index).
     // See updateMetaCache()
     const int mappedStateIndex = d->m_stateIndexToSignalIndex.key(stateIndex, -1);
-    return d->m_configuration.contains(mappedStateIndex);
+    return d->isStateActive(mappedStateIndex);
+}
+
+/*!
+  \typedef QScxmlStateMachine::BoolEvaluator
+  \internal
+ */
+
+/*!
+  \internal
+  \since 6.6
+
+  Registers the \a count functions in \a evaluators, indexed by evaluator ID, which are then
+  called directly to evaluate transition conditions. Entries can be \nullptr, in which case
+  QScxmlDataModel::evaluateToBool() is used. The functions are only called if the data model
+  of the state machine is an instance of \a dataModelType. The array has to stay valid for the
+  lifetime of the state machine.
+
+  This method is part of the interface to the compiled representation of SCXML
+  state machines. It is called by state machines that the Qt SCXML compiler generates with
+  the \c --evaluator-table option.
+ */
+void QScxmlStateMachine::setBoolEvaluators(const QMetaObject *dataModelType,
+                                           const BoolEvaluator *evaluators, int count)
+{
+    Q_D(QScxmlStateMachine);
+    Q_ASSERT(dataModelType || !evaluators);
+    d->m_boolEvaluators = evaluators;
+    d->m_boolEvaluatorCount = evaluators ? count : 0;
+    d->m_boolEvaluatorDataModelType = dataModelType;
+    d->updateBoolEvaluators();
 }
 
 QT_END_NAMESPACE
@@ -25,6 +25,7 @@ class QIODevice;
 class QXmlStreamWriter;
 class QTextStream;
 class QScxmlTableData;
+class QScxmlLogSink;
 
 class QScxmlStateMachinePrivate;
 class Q_SCXML_EXPORT QScxmlStateMachine: public QObject
@@ -56,6 +57,8 @@ protected:
 public:
     static QScxmlStateMachine *fromFile(const QString &fileName);
     static QScxmlStateMachine *fromData(QIODevice *data, const QString &fileName = QString());
+    static QScxmlStateMachine *fromData(const QByteArray &data, const QString &fileName = QString());
+    static QScxmlStateMachine *fromCompiledFile(const QString &fileName);
     QList<QScxmlError> parseErrors() const;
 
     QString sessionId() const;
@@ -258,6 +261,9 @@ public:
     void setTableData(QScxmlTableData *tableData);
     QBindable<QScxmlTableData*> bindableTableData();
 
+    QScxmlLogSink *logSink() const;
+    void setLogSink(QScxmlLogSink *sink);
+
 Q_SIGNALS:
     void runningChanged(bool running);
     void invokedServicesChanged(const QList<QScxmlInvokableService *> &invokedServices);
@@ -284,6 +290,10 @@ protected: // methods for friends:
     // The methods below are used by the compiled state machines.
     bool isActive(int stateIndex) const;
 
+    typedef bool (*BoolEvaluator)(QScxmlDataModel *dataModel, bool *ok);
+    void setBoolEvaluators(const QMetaObject *dataModelType, const BoolEvaluator *evaluators,
+                           int count);
+
 private:
     QMetaObject::Connection connectToStateImpl(const QString &scxmlStateName,
                                                const QObject *receiver, void **slot,
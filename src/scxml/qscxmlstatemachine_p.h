@@ -16,7 +16,9 @@
 //
 
 #include <QtScxml/private/qscxmlexecutablecontent_p.h>
+#include <QtScxml/private/qscxmlevent_p.h>
 #include <QtScxml/qscxmlstatemachine.h>
+#include <QtScxml/qscxmllogsink.h>
 #include <QtScxml/private/qscxmlstatemachineinfo_p.h>
 #include <QtCore/private/qobject_p.h>
 #include <QtCore/private/qmetaobject_p.h>
@@ -213,6 +215,39 @@ public: // types
         }
     };
 
+    // Keeps a number of spare events around, so that the events created and consumed by the
+    // state machine itself don't have to be allocated and freed one by one. Events handed out by
+    // the pool are plain heap allocated QScxmlEvents, so whoever ends up owning them can also
+    // just delete them.
+    class EventPool
+    {
+        std::vector<QScxmlEvent *> spare;
+        enum { MaxSpareEvents = 64 };
+
+    public:
+        ~EventPool()
+        { qDeleteAll(spare); }
+
+        QScxmlEvent *take()
+        {
+            if (spare.empty())
+                return new QScxmlEvent;
+            QScxmlEvent *e = spare.back();
+            spare.pop_back();
+            return e;
+        }
+
+        void recycle(QScxmlEvent *e)
+        {
+            if (spare.size() < MaxSpareEvents) {
+                QScxmlEventPrivate::reset(e);
+                spare.push_back(e);
+            } else {
+                delete e;
+            }
+        }
+    };
+
 public:
     QScxmlStateMachinePrivate(const QMetaObject *qMetaObject);
     ~QScxmlStateMachinePrivate();
@@ -237,6 +272,12 @@ public:
     void postEvent(QScxmlEvent *event);
     void submitDelayedEvent(QScxmlEvent *event);
     void submitError(const QString &type, const QString &msg, const QString &sendid = QString());
+    void raiseInternalEvent(QScxmlExecutableContent::StringId eventName);
+    QScxmlEvent *newEvent() { return m_eventPool.take(); }
+    QScxmlEvent *copyEvent(const QScxmlEvent &event);
+    void recycleEvent(QScxmlEvent *event) { m_eventPool.recycle(event); }
+    void log(const QString &label, const QString &message);
+    void flushLogRecords();
 
     void start();
     void pause();
@@ -251,8 +292,25 @@ public:
     void attach(QScxmlStateMachineInfo *info);
     const OrderedSet &configuration() const { return m_configuration; }
 
+    // The In() predicate of the data models resolves the state name once, and then only tests
+    // a bit for each evaluation.
+    int stateIndexForName(const QString &name) const
+    { return m_stateIndexForName.value(name, StateTable::InvalidIndex); }
+
+    bool isStateActive(int stateIndex) const
+    {
+        return stateIndex >= 0 && size_t(stateIndex) < m_activeStates.size()
+                && m_activeStates[size_t(stateIndex)];
+    }
+
     void updateMetaCache();
 
+    // Strings are fetched from the table data once per state machine. The views stay valid as
+    // long as the table data is set.
+    QStringView stringView(QScxmlExecutableContent::StringId id) const
+    { return string(id); }
+    const QString &string(QScxmlExecutableContent::StringId id) const;
+
 private:
     QStringList stateNames(const std::vector<int> &stateIndexes) const;
     std::vector<int> historyStates(int stateIdx) const;
@@ -260,6 +318,7 @@ private:
     void exitInterpreter();
     void returnDoneEvent(QScxmlExecutableContent::ContainerId doneData);
     bool nameMatch(const StateTable::Array &patterns, QScxmlEvent *event) const;
+    bool evaluateCondition(QScxmlExecutableContent::EvaluatorId condition) const;
     void selectTransitions(OrderedSet &enabledTransitions,
                            const std::vector<int> &configInDocumentOrder,
                            QScxmlEvent *event) const;
@@ -344,6 +403,15 @@ public: // types & data fields:
     DelayedQueue m_delayedEvents;
     const QMetaObject *m_metaObject;
     QScxmlInternal::ScxmlEventRouter m_router;
+    mutable std::vector<QString> m_strings;
+
+    // Set by state machines generated with qscxmlc --evaluator-table, indexed by evaluator id.
+    // They are only called once the data model is known to be of the type they expect.
+    const QScxmlStateMachine::BoolEvaluator *m_boolEvaluators = nullptr;
+    int m_boolEvaluatorCount = 0;
+    const QMetaObject *m_boolEvaluatorDataModelType = nullptr;
+    bool m_useBoolEvaluators = false;
+    void updateBoolEvaluators();
 
 private:
     QScopedPointer<ParserData> m_parserData; // used when created by StateMachine::fromFile.
@@ -357,6 +425,7 @@ private:
     // TODO: move the stuff below to a struct that can be reset
     HistoryValues m_historyValue;
     OrderedSet m_configuration;
+    std::vector<bool> m_activeStates; // the configuration, indexed by state
     Queue m_internalQueue;
     Queue m_externalQueue;
     QSet<int> m_statesToInvoke;
@@ -396,6 +465,15 @@ private:
 
     QHash<int, int> m_stateIndexToSignalIndex;
     QHash<QString, int> m_stateNameToSignalIndex;
+    QHash<QString, int> m_stateIndexForName;
+
+    // Event names for <raise>, interned per string id so that raising an event only bumps
+    // a reference count.
+    std::vector<QString> m_internedEventNames;
+    EventPool m_eventPool;
+
+    QScxmlLogSink *m_logSink = nullptr;
+    QList<QScxmlLogSink::Record> m_logRecords;
 };
 
 QT_END_NAMESPACE
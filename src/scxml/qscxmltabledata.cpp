@@ -7,6 +7,9 @@
 
 #include <QtCore/qmap.h>
 
+#include <algorithm>
+#include <vector>
+
 QT_USE_NAMESPACE
 
 /*!
@@ -109,6 +112,9 @@ public:
     void buildTableData(DocumentModel::ScxmlDocument *doc)
     {
         m_isCppDataModel = doc->root->dataModel == DocumentModel::Scxml::CppDataModel;
+        // C++ data models can look at the event in arbitrary methods, so we have to assume they do.
+        if (m_isCppDataModel)
+            m_stateTable.flags |= StateTable::EventVariableUsed;
         m_parents.reserve(32);
         m_allTransitions.resize(doc->allTransitions.size());
         m_docTransitionIndices.reserve(doc->allTransitions.size());
@@ -287,8 +293,10 @@ protected: // visitor
             for (DocumentModel::Invoke *invoke : std::as_const(state->invokes)) {
                 auto ctxt = createContext(QStringLiteral("invoke"));
                 QList<QScxmlExecutableContent::StringId> namelist;
-                for (const QString &name : std::as_const(invoke->namelist))
+                for (const QString &name : std::as_const(invoke->namelist)) {
+                    checkEventVariableUse(name);
                     namelist += addString(name);
+                }
                 QList<QScxmlExecutableContent::ParameterInfo> params;
                 for (DocumentModel::Param *param : std::as_const(invoke->params)) {
                     QScxmlExecutableContent::ParameterInfo p;
@@ -296,6 +304,7 @@ protected: // visitor
                     p.expr = createEvaluatorVariant(QStringLiteral("param"), QStringLiteral("expr"),
                                                     param->expr);
                     p.location = addString(param->location);
+                    checkEventVariableUse(param->location);
                     params.append(p);
                 }
                 QScxmlExecutableContent::ContainerId finalize =
@@ -551,6 +560,8 @@ protected:
     void generate(const QList<DocumentModel::DataElement *> &dataElements)
     {
         for (DocumentModel::DataElement *el : dataElements) {
+            if (isCppDataModel() && !el->type.isEmpty())
+                m_dataModelInfo.typedData.append({ el->id, el->type });
             auto ctxt = createContext(QStringLiteral("data"), QStringLiteral("expr"), el->expr);
             auto evaluator = addDataElement(el->id, el->expr, ctxt);
             if (evaluator != NoEvaluator) {
@@ -580,6 +591,7 @@ protected:
             it->expr = createEvaluatorVariant(QStringLiteral("param"), QStringLiteral("expr"),
                                               f->expr);
             it->location = addString(f->location);
+            checkEventVariableUse(f->location);
             ++it;
         }
     }
@@ -606,6 +618,7 @@ protected:
         out->count = in.size();
         StringId *it = out->data();
         for (const QString &str : in) {
+            checkEventVariableUse(str);
             *it++ = addString(str);
         }
     }
@@ -653,7 +666,11 @@ protected:
                 m_dataModelInfo.stringEvaluators.insert(id, expr);
                 return id;
             } else {
-                return addEvaluator(expr, createContext(instrName, attrName, expr));
+                auto id = addEvaluator(expr, createContext(instrName, attrName, expr));
+#ifdef BUILD_QSCXMLC
+                m_dataModelInfo.stringEvaluators.insert(id, expr);
+#endif
+                return id;
             }
         }
 
@@ -669,7 +686,11 @@ protected:
                 m_dataModelInfo.boolEvaluators.insert(id, cond);
                 return id;
             } else {
-                return addEvaluator(cond, createContext(instrName, attrName, cond));
+                auto id = addEvaluator(cond, createContext(instrName, attrName, cond));
+#ifdef BUILD_QSCXMLC
+                m_dataModelInfo.boolEvaluators.insert(id, cond);
+#endif
+                return id;
             }
         }
 
@@ -685,7 +706,11 @@ protected:
                 m_dataModelInfo.variantEvaluators.insert(id, expr);
                 return id;
             } else {
-                return addEvaluator(expr, createContext(instrName, attrName, expr));
+                auto id = addEvaluator(expr, createContext(instrName, attrName, expr));
+#ifdef BUILD_QSCXMLC
+                m_dataModelInfo.variantEvaluators.insert(id, expr);
+#endif
+                return id;
             }
         }
 
@@ -784,8 +809,35 @@ protected:
         return QStringLiteral("%1 with %2=\"%3\"").arg(location, attrName, attrValue);
     }
 
+    // Conservatively checks whether a piece of data model code mentions the _event system
+    // variable. Code that calls eval() might construct the name, so it counts as well.
+    static bool mentionsEventVariable(const QString &code)
+    {
+        const auto isIdentifierChar = [](QChar c) {
+            return c.isLetterOrNumber() || c == QLatin1Char('_') || c == QLatin1Char('$');
+        };
+        const auto mentions = [&](QLatin1String name) {
+            for (qsizetype from = 0; (from = code.indexOf(name, from)) != -1; from += name.size()) {
+                const qsizetype end = from + name.size();
+                if ((from == 0 || !isIdentifierChar(code.at(from - 1)))
+                        && (end == code.size() || !isIdentifierChar(code.at(end)))) {
+                    return true;
+                }
+            }
+            return false;
+        };
+        return mentions(QLatin1String("_event")) || mentions(QLatin1String("eval"));
+    }
+
+    void checkEventVariableUse(const QString &code)
+    {
+        if (!(m_stateTable.flags & StateTable::EventVariableUsed) && mentionsEventVariable(code))
+            m_stateTable.flags |= StateTable::EventVariableUsed;
+    }
+
     EvaluatorId addEvaluator(const QString &expr, const QString &context)
     {
+        checkEventVariableUse(expr);
         EvaluatorInfo ei;
         ei.expr = addString(expr);
         ei.context = addString(context);
@@ -794,16 +846,21 @@ protected:
 
     EvaluatorId addAssignment(const QString &dest, const QString &expr, const QString &context)
     {
+        checkEventVariableUse(expr);
         AssignmentInfo ai;
         ai.dest = addString(dest);
         ai.expr = addString(expr);
         ai.context = addString(context);
-        return m_assignments.add(ai);
+        auto id = m_assignments.add(ai);
+        if (isCppDataModel())
+            m_dataModelInfo.assignments.insert(id, { dest, expr });
+        return id;
     }
 
     EvaluatorId addForeach(const QString &array, const QString &item, const QString &index,
                            const QString &context)
     {
+        checkEventVariableUse(array);
         ForeachInfo fi;
         fi.array = addString(array);
         fi.item = addString(item);
@@ -824,10 +881,10 @@ protected:
     }
 
 private:
-    template <class Container, typename T, typename U>
+    template <class Container, typename T, typename U, class Index = QMap<T, int>>
     class Table {
         Container &elements;
-        QMap<T, int> indexForElement;
+        Index indexForElement;
 
     public:
         Table(Container &storage)
@@ -907,7 +964,8 @@ private:
     GeneratedTableData::CreateFactoryId createFactoryId;
     GeneratedTableData &m_tableData;
     GeneratedTableData::DataModelInfo &m_dataModelInfo;
-    Table<QStringList, QString, StringId> m_stringTable;
+    // Strings are interned through a hash, as big charts have many of them.
+    Table<QStringList, QString, StringId, QHash<QString, int>> m_stringTable;
     InstructionStorage m_instructions;
     Table<QList<EvaluatorInfo>, EvaluatorInfo, EvaluatorId> m_evaluators;
     Table<QList<AssignmentInfo>, AssignmentInfo, EvaluatorId> m_assignments;
@@ -928,7 +986,241 @@ private:
     int m_currentTransition = StateTable::InvalidIndex;
     bool m_bindLate = false;
     QList<DocumentModel::DataElement *> m_dataElements;
-    Table<QStringList, QString, int> m_stateNames;
+    Table<QStringList, QString, int, QHash<QString, int>> m_stateNames;
+};
+
+// Computes the paths of the transitions that neither target nor enter a history state, in the same
+// way as QScxmlStateMachinePrivate computes the entry and exit sets of a single transition at run
+// time, with an empty history.
+class TransitionPathBuilder
+{
+public:
+    TransitionPathBuilder(const StateTable *stateTable)
+        : m_stateTable(stateTable)
+        , m_firstDescendant(size_t(stateTable->stateCount))
+        , m_lastDescendant(size_t(stateTable->stateCount))
+        , m_descendantCount(size_t(stateTable->stateCount), 0)
+    {
+        for (int s = 0; s < m_stateTable->stateCount; ++s) {
+            m_firstDescendant[size_t(s)] = s + 1;
+            m_lastDescendant[size_t(s)] = s;
+        }
+        for (int s = 0; s < m_stateTable->stateCount; ++s) {
+            for (int anc = parent(s); anc != StateTable::InvalidIndex; anc = parent(anc)) {
+                m_firstDescendant[size_t(anc)] = std::min(m_firstDescendant[size_t(anc)], s);
+                m_lastDescendant[size_t(anc)] = std::max(m_lastDescendant[size_t(anc)], s);
+                ++m_descendantCount[size_t(anc)];
+            }
+        }
+    }
+
+    // Appends the paths to arrays, and returns the offset of the array that holds the offset of
+    // the path of each transition, or -1.
+    int addPaths(QList<qint32> *arrays)
+    {
+        QList<qint32> offsets;
+        offsets.reserve(m_stateTable->transitionCount);
+        for (int t = 0; t < m_stateTable->transitionCount; ++t) {
+            QList<qint32> path;
+            if (computePath(t, &path)) {
+                offsets.append(qint32(arrays->size()));
+                arrays->append(qint32(path.size()));
+                arrays->append(path);
+            } else {
+                offsets.append(StateTable::InvalidIndex);
+            }
+        }
+
+        const int res = int(arrays->size());
+        arrays->append(qint32(offsets.size()));
+        arrays->append(offsets);
+        return res;
+    }
+
+private:
+    int parent(int s) const { return m_stateTable->state(s).parent; }
+
+    bool computePath(int transitionIndex, QList<qint32> *path)
+    {
+        const auto &transition = m_stateTable->transition(transitionIndex);
+        if (transition.targets == StateTable::InvalidIndex)
+            return false; // no exit or entry set at all
+
+        const StateTable::Array targets = m_stateTable->array(transition.targets);
+        for (int s : targets) {
+            if (m_stateTable->state(s).isHistoryState())
+                return false;
+        }
+
+        const int domain = transitionDomain(transitionIndex);
+        int lastDescendant = m_stateTable->stateCount - 1;
+        if (domain != StateTable::InvalidIndex) {
+            // The states to exit are found by their index, so the descendants of the domain have
+            // to follow it without any other states in between.
+            lastDescendant = m_lastDescendant[size_t(domain)];
+            if (m_firstDescendant[size_t(domain)] <= domain
+                    || lastDescendant - domain != m_descendantCount[size_t(domain)]) {
+                return false;
+            }
+        }
+
+        m_statesToEnter.clear();
+        m_statesForDefaultEntry.clear();
+        m_entersHistory = false;
+        for (int s : targets)
+            addDescendantStatesToEnter(s);
+        for (int s : targets)
+            addAncestorStatesToEnter(s, domain);
+        if (m_entersHistory)
+            return false;
+
+        std::sort(m_statesToEnter.begin(), m_statesToEnter.end());
+        path->append(domain);
+        path->append(lastDescendant);
+        for (int s : std::as_const(m_statesToEnter)) {
+            path->append(s);
+            const auto &state = m_stateTable->state(s);
+            if (contains(m_statesForDefaultEntry, s)
+                    && state.initialTransition != StateTable::InvalidIndex) {
+                path->append(m_stateTable->transition(state.initialTransition)
+                             .transitionInstructions);
+            } else {
+                path->append(StateTable::InvalidIndex);
+            }
+        }
+        return true;
+    }
+
+    static bool contains(const std::vector<int> &set, int s)
+    { return std::find(set.cbegin(), set.cend(), s) != set.cend(); }
+
+    static void add(std::vector<int> *set, int s)
+    {
+        if (!contains(*set, s))
+            set->push_back(s);
+    }
+
+    bool isDescendant(int state1, int state2) const
+    {
+        for (int anc = parent(state1); anc != StateTable::InvalidIndex; anc = parent(anc)) {
+            if (anc == state2)
+                return true;
+        }
+        return state2 == StateTable::InvalidIndex;
+    }
+
+    bool allDescendants(const std::vector<int> &states, int ancestor) const
+    {
+        for (int s : states) {
+            if (!isDescendant(s, ancestor))
+                return false;
+        }
+        return true;
+    }
+
+    bool hasDescendant(int ancestor) const
+    {
+        for (int s : m_statesToEnter) {
+            if (isDescendant(s, ancestor))
+                return true;
+        }
+        return false;
+    }
+
+    std::vector<int> childStates(const StateTable::State &state) const
+    {
+        std::vector<int> children;
+        if (state.childStates == StateTable::InvalidIndex)
+            return children;
+        for (int child : m_stateTable->array(state.childStates)) {
+            switch (m_stateTable->state(child).type) {
+            case StateTable::State::Normal:
+            case StateTable::State::Final:
+            case StateTable::State::Parallel:
+                children.push_back(child);
+                break;
+            default:
+                break;
+            }
+        }
+        return children;
+    }
+
+    int transitionDomain(int transitionIndex) const
+    {
+        const auto &transition = m_stateTable->transition(transitionIndex);
+        if (transition.source == StateTable::InvalidIndex)
+            return StateTable::InvalidIndex;
+
+        std::vector<int> targets;
+        for (int s : m_stateTable->array(transition.targets))
+            add(&targets, s);
+        const auto &source = m_stateTable->state(transition.source);
+        if (transition.type == StateTable::Transition::Internal && source.isCompound()
+                && allDescendants(targets, transition.source)) {
+            return transition.source;
+        }
+
+        // The least common compound ancestor of the source and the targets.
+        add(&targets, transition.source);
+        const int head = targets.front();
+        targets.erase(targets.begin());
+        for (int anc = parent(head); anc != StateTable::InvalidIndex; anc = parent(anc)) {
+            if (m_stateTable->state(anc).isCompound() && allDescendants(targets, anc))
+                return anc;
+        }
+        return StateTable::InvalidIndex;
+    }
+
+    void addDescendantStatesToEnter(int stateIndex)
+    {
+        const auto &state = m_stateTable->state(stateIndex);
+        if (state.isHistoryState()) {
+            m_entersHistory = true;
+            return;
+        }
+
+        add(&m_statesToEnter, stateIndex);
+        if (state.isCompound()) {
+            add(&m_statesForDefaultEntry, stateIndex);
+            if (state.initialTransition != StateTable::InvalidIndex) {
+                const auto &initialTransition = m_stateTable->transition(state.initialTransition);
+                const StateTable::Array targets = m_stateTable->array(initialTransition.targets);
+                for (int s : targets)
+                    addDescendantStatesToEnter(s);
+                for (int s : targets)
+                    addAncestorStatesToEnter(s, stateIndex);
+            }
+        } else if (state.isParallel()) {
+            for (int child : childStates(state)) {
+                if (!hasDescendant(child))
+                    addDescendantStatesToEnter(child);
+            }
+        }
+    }
+
+    void addAncestorStatesToEnter(int stateIndex, int ancestorIndex)
+    {
+        for (int anc = parent(stateIndex); anc != ancestorIndex && anc != StateTable::InvalidIndex;
+             anc = parent(anc)) {
+            add(&m_statesToEnter, anc);
+            const auto &ancState = m_stateTable->state(anc);
+            if (ancState.isParallel()) {
+                for (int child : childStates(ancState)) {
+                    if (!hasDescendant(child))
+                        addDescendantStatesToEnter(child);
+                }
+            }
+        }
+    }
+
+    const StateTable *m_stateTable;
+    std::vector<int> m_firstDescendant;
+    std::vector<int> m_lastDescendant;
+    std::vector<int> m_descendantCount;
+    std::vector<int> m_statesToEnter;
+    std::vector<int> m_statesForDefaultEntry;
+    bool m_entersHistory = false;
 };
 
 } // anonymous namespace
@@ -950,6 +1242,32 @@ void GeneratedTableData::build(DocumentModel::ScxmlDocument *doc,
     builder.buildTableData(doc);
 }
 
+/*!
+    \internal
+    Precomputes the entry and exit sets of the transitions in the state machine table of \a table
+    that neither target nor enter a history state, so that the state machine does not have to
+    compute them every time such a transition is taken on its own.
+ */
+void GeneratedTableData::precomputeTransitionPaths(GeneratedTableData *table)
+{
+    QList<qint32> &data = table->theStateMachineTable;
+    const StateTable *stateTable = reinterpret_cast<const StateTable *>(data.constData());
+    if (stateTable->transitionPaths != StateTable::InvalidIndex)
+        return;
+
+    QList<qint32> arrays(data.constBegin() + stateTable->arrayOffset,
+                         data.constBegin() + stateTable->arrayOffset + stateTable->arraySize);
+    const int transitionPaths = TransitionPathBuilder(stateTable).addPaths(&arrays);
+
+    data.resize(stateTable->arrayOffset);
+    data.append(arrays);
+    data.append(StateTable::terminator);
+
+    StateTable *header = reinterpret_cast<StateTable *>(data.data());
+    header->arraySize = int(arrays.size());
+    header->transitionPaths = transitionPaths;
+}
+
 QString GeneratedTableData::toString(const int *stateMachineTable)
 {
     QString result;
@@ -971,6 +1289,9 @@ QString GeneratedTableData::toString(const int *stateMachineTable)
         << "\t" << st->transitionOffset << ", " << st->transitionCount
                                                 << ", // transition offset and count" << Qt::endl
         << "\t" << st->arrayOffset << ", " << st->arraySize << ", // array offset and size" << Qt::endl
+        << "\t0x" << Qt::hex << st->flags << Qt::dec << ", // flags" << Qt::endl
+        << "\t" << st->ecmaScriptModule << ", // ECMAScript module" << Qt::endl
+        << "\t" << st->transitionPaths << ", // transition paths" << Qt::endl
         << Qt::endl;
 
     out << "\t// States:" << Qt::endl;
@@ -1026,6 +1347,34 @@ QString GeneratedTableData::toString(const int *stateMachineTable)
     return result;
 }
 
+/*!
+    \internal
+    Returns the source of a JavaScript function expression that evaluates \a expr in the way
+    given by \a kind. The ECMAScript data model compiles its expressions with this at runtime,
+    and qscxmlc uses it to pre-compile them.
+ */
+QString GeneratedTableData::ecmaScriptFunction(EcmaScriptFunctionKind kind, const QString &expr)
+{
+    // The expression goes on its own lines, so that a trailing comment cannot swallow the rest.
+    QString body;
+    switch (kind) {
+    case StringFunction:
+        body = QStringLiteral("return (\n") + expr + QStringLiteral("\n).toString();");
+        break;
+    case BoolFunction:
+        body = QStringLiteral("return !!(\n") + expr + QStringLiteral("\n);");
+        break;
+    case ValueFunction:
+    case AssignmentFunction:
+        body = QStringLiteral("return (\n") + expr + QStringLiteral("\n);");
+        break;
+    default:
+        Q_UNREACHABLE();
+    }
+
+    return QStringLiteral("function(){'use strict'; ") + body + QStringLiteral("\n}");
+}
+
 QString GeneratedTableData::string(StringId id) const
 {
     return id == NoString ? QString() : theStrings.at(id);
@@ -8,7 +8,7 @@
 #include <QtCore/qstring.h>
 
 #ifndef Q_QSCXMLC_OUTPUT_REVISION
-#define Q_QSCXMLC_OUTPUT_REVISION 2
+#define Q_QSCXMLC_OUTPUT_REVISION 4
 #endif
 
 QT_BEGIN_NAMESPACE
@@ -46,11 +46,26 @@ public:
         QStringList stateNames;
     };
 
+    // For the C++ data model this holds the code of all evaluators. qscxmlc also fills it for the
+    // ECMAScript data model, so that it can pre-compile the expressions.
     struct DataModelInfo {
         QHash<QScxmlExecutableContent::EvaluatorId, QString> stringEvaluators;
         QHash<QScxmlExecutableContent::EvaluatorId, QString> boolEvaluators;
         QHash<QScxmlExecutableContent::EvaluatorId, QString> variantEvaluators;
         QHash<QScxmlExecutableContent::EvaluatorId, QString> voidEvaluators;
+
+        // C++ data model only: the data items declared with a qt:type, and all assignments and
+        // data initializations, so that qscxmlc can turn them into plain member access.
+        struct TypedData {
+            QString name;
+            QString type;
+        };
+        struct Assignment {
+            QString location;
+            QString expr;
+        };
+        QList<TypedData> typedData;
+        QHash<QScxmlExecutableContent::EvaluatorId, Assignment> assignments;
     };
 
 public:
@@ -58,6 +73,17 @@ public:
                       MetaDataInfo *metaDataInfo, DataModelInfo *dataModelInfo,
                       CreateFactoryId func);
     static QString toString(const int *stateMachineTable);
+    static void precomputeTransitionPaths(GeneratedTableData *table);
+
+    // The ways in which the ECMAScript data model evaluates expressions.
+    enum EcmaScriptFunctionKind {
+        StringFunction,
+        BoolFunction,
+        ValueFunction,
+        AssignmentFunction,
+        FunctionKindCount
+    };
+    static QString ecmaScriptFunction(EcmaScriptFunctionKind kind, const QString &expr);
 
 public:
     QString string(QScxmlExecutableContent::StringId id) const override final;
@@ -8,7 +8,6 @@
 #include <qqmlengine.h>
 #include <qqmlinfo.h>
 #include <qqmlfile.h>
-#include <qbuffer.h>
 
 /*!
     \qmltype StateMachineLoader
@@ -145,13 +144,6 @@ bool QScxmlStateMachineLoader::parse(const QUrl &source)
         return false;
     }
 
-    QByteArray data(scxmlFile.dataByteArray());
-    QBuffer buf(&data);
-    if (!buf.open(QIODevice::ReadOnly)) {
-        qmlWarning(this) << QStringLiteral("Cannot open input buffer for reading");
-        return false;
-    }
-
     QString fileName;
     if (source.isLocalFile()) {
         fileName = source.toLocalFile();
@@ -163,7 +155,7 @@ bool QScxmlStateMachineLoader::parse(const QUrl &source)
                          << QStringLiteral("Invoking services by relative path will not work.");
     }
 
-    auto stateMachine = QScxmlStateMachine::fromData(&buf, fileName);
+    auto stateMachine = QScxmlStateMachine::fromData(scxmlFile.dataByteArray(), fileName);
     stateMachine->setParent(this);
     m_implicitDataModel = stateMachine->dataModel();
 
@@ -0,0 +1,22 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
+
+#ifndef EVALUATORTABLEDATAMODEL_H
+#define EVALUATORTABLEDATAMODEL_H
+
+#include <QtScxml/qscxmlcppdatamodel.h>
+
+class EvaluatorTableDataModel: public QScxmlCppDataModel
+{
+    Q_OBJECT
+    Q_SCXML_DATAMODEL
+
+public:
+    int ticks = 0;
+    int guardCalls = 0;
+
+private:
+    bool countGuard(bool result) { ++guardCalls; return result; }
+};
+
+#endif // EVALUATORTABLEDATAMODEL_H
@@ -7,6 +7,7 @@
 #include <QtScxml/qscxmlcompiler.h>
 #include <QtScxml/qscxmlstatemachine.h>
 #include <QtScxml/qscxmlinvokableservice.h>
+#include <QtScxml/private/qscxmlstatemachine_p.h>
 #include "ids1.h"
 #include "statemachineunicodename.h"
 #include "datainnulldatamodel.h"
@@ -15,6 +16,15 @@
 #include "connection.h"
 #include "topmachine.h"
 #include "historyState.h"
+#include "precompiledecmascript.h"
+#include "typeddatamodel.h"
+#include "typeddata.h"
+#include "evaluatortabledatamodel.h"
+#include "evaluatortable.h"
+#include "prunedstates.h"
+#include "pruneddata.h"
+#include "precomputedtransitions.h"
+#include "inlinesubmachines.h"
 
 enum { SpyWaitTime = 8000 };
 
@@ -33,6 +43,13 @@ private Q_SLOTS:
     void topMachineDynamic();
     void publicSignals();
     void historyState();
+    void precompiledEcmaScript();
+    void typedDataModel();
+    void evaluatorTable();
+    void prunedStates();
+    void prunedData();
+    void precomputedTransitions();
+    void inlineSubMachines();
 };
 
 void tst_Compiled::stateNames()
@@ -297,6 +314,185 @@ void tst_Compiled::historyState()
     QCOMPARE(historyStateSM.activeStateNames(), QStringList(QLatin1String("Beta")));
 }
 
+void tst_Compiled::precompiledEcmaScript()
+{
+    {
+        PrecompiledEcmaScript stateMachine;
+        QSignalSpy stableStateSpy(&stateMachine, SIGNAL(reachedStableState()));
+        stateMachine.start();
+        QTRY_COMPARE(stableStateSpy.size(), 1);
+
+        for (int i = 0; i < 3; ++i)
+            stateMachine.submitEvent("inc");
+        QTRY_COMPARE(stateMachine.activeStateNames(), QStringList(QLatin1String("done")));
+        QCOMPARE(stateMachine.dataModel()->scxmlProperty(QStringLiteral("x")).toInt(), 2);
+    }
+
+    {
+        // Errors in pre-compiled expressions are reported like any other evaluation error.
+        PrecompiledEcmaScript stateMachine;
+        QSignalSpy stableStateSpy(&stateMachine, SIGNAL(reachedStableState()));
+        stateMachine.start();
+        QTRY_COMPARE(stableStateSpy.size(), 1);
+
+        stateMachine.submitEvent("broken");
+        QTRY_COMPARE(stateMachine.activeStateNames(), QStringList(QLatin1String("failed")));
+    }
+}
+
+void tst_Compiled::typedDataModel()
+{
+    TypedDataModel dataModel;
+    TypedDataModelMachine stateMachine;
+    stateMachine.setDataModel(&dataModel);
+    QSignalSpy stableStateSpy(&stateMachine, SIGNAL(reachedStableState()));
+    stateMachine.start();
+    QTRY_COMPARE(stableStateSpy.size(), 1);
+    QCOMPARE(dataModel.counterValue(), 1);
+
+    QVERIFY(dataModel.hasScxmlProperty(QStringLiteral("counter")));
+    QVERIFY(dataModel.hasScxmlProperty(QStringLiteral("label")));
+    QVERIFY(!dataModel.hasScxmlProperty(QStringLiteral("other")));
+    QCOMPARE(dataModel.scxmlProperty(QStringLiteral("label")).toString(),
+             QStringLiteral("ticks"));
+
+    for (int i = 0; i < 3; ++i)
+        stateMachine.submitEvent("tick");
+    QTRY_COMPARE(stateMachine.activeStateNames(), QStringList(QLatin1String("done")));
+    QCOMPARE(dataModel.counterValue(), 3);
+
+    QVERIFY(dataModel.setScxmlProperty(QStringLiteral("counter"), 7, QString()));
+    QCOMPARE(dataModel.counterValue(), 7);
+    QCOMPARE(dataModel.scxmlProperty(QStringLiteral("counter")).toInt(), 7);
+    QVERIFY(!dataModel.setScxmlProperty(QStringLiteral("other"), 7, QString()));
+}
+
+// Replaces the evaluator table that qscxmlc generated with one that counts the calls, and forwards
+// them to the generated functions.
+namespace EvaluatorTableSpy {
+using BoolEvaluator = std::remove_const_t<std::remove_pointer_t<
+        decltype(QScxmlStateMachinePrivate::m_boolEvaluators)>>;
+
+enum { MaxEvaluators = 8 };
+static const BoolEvaluator *generated = nullptr;
+static int calls = 0;
+
+template<int Id>
+bool evaluate(QScxmlDataModel *dataModel, bool *ok)
+{
+    if (!generated[Id])
+        return dataModel->evaluateToBool(Id, ok);
+    ++calls;
+    return generated[Id](dataModel, ok);
+}
+
+template<int... Ids>
+const BoolEvaluator *table(std::integer_sequence<int, Ids...>)
+{
+    static const BoolEvaluator evaluators[] = { &evaluate<Ids>... };
+    return evaluators;
+}
+} // namespace EvaluatorTableSpy
+
+void tst_Compiled::evaluatorTable()
+{
+    EvaluatorTableDataModel dataModel;
+    EvaluatorTable stateMachine;
+    stateMachine.setDataModel(&dataModel);
+
+    QScxmlStateMachinePrivate *d = QScxmlStateMachinePrivate::get(&stateMachine);
+    QVERIFY(d->m_useBoolEvaluators);
+    QVERIFY(d->m_boolEvaluatorCount <= EvaluatorTableSpy::MaxEvaluators);
+    EvaluatorTableSpy::generated = d->m_boolEvaluators;
+    EvaluatorTableSpy::calls = 0;
+    d->m_boolEvaluators = EvaluatorTableSpy::table(
+                std::make_integer_sequence<int, EvaluatorTableSpy::MaxEvaluators>());
+
+    QSignalSpy stableStateSpy(&stateMachine, SIGNAL(reachedStableState()));
+    stateMachine.start();
+    QTRY_COMPARE(stableStateSpy.size(), 1);
+
+    for (int i = 0; i < 3; ++i)
+        stateMachine.submitEvent("tick");
+    QTRY_COMPARE(stateMachine.activeStateNames(), QStringList(QLatin1String("done")));
+    QCOMPARE(dataModel.ticks, 2);
+    // Two events pass the first condition, the last one fails it and passes the second one.
+    QCOMPARE(dataModel.guardCalls, 4);
+    // All of them went through the table, none through the virtual evaluateToBool().
+    QCOMPARE(EvaluatorTableSpy::calls, dataModel.guardCalls);
+}
+
+void tst_Compiled::prunedStates()
+{
+    PrunedStates stateMachine;
+    QCOMPARE(stateMachine.stateNames(false),
+             QStringList({ QLatin1String("idle"), QLatin1String("working"),
+                           QLatin1String("done") }));
+
+    QSignalSpy finishedSpy(&stateMachine, SIGNAL(finished()));
+    stateMachine.start();
+    QTRY_COMPARE(stateMachine.activeStateNames(), QStringList(QLatin1String("idle")));
+    stateMachine.submitEvent("go");
+    QTRY_COMPARE(finishedSpy.size(), 1);
+}
+
+void tst_Compiled::prunedData()
+{
+    // The data of a pruned state is still declared and initialized.
+    PrunedData stateMachine;
+    QCOMPARE(stateMachine.stateNames(false),
+             QStringList({ QLatin1String("idle"), QLatin1String("done") }));
+
+    QSignalSpy finishedSpy(&stateMachine, SIGNAL(finished()));
+    stateMachine.start();
+    QTRY_COMPARE(stateMachine.activeStateNames(), QStringList(QLatin1String("idle")));
+    QVERIFY(stateMachine.dataModel()->hasScxmlProperty(QStringLiteral("orphanData")));
+    stateMachine.submitEvent("check");
+    QTRY_COMPARE(finishedSpy.size(), 1);
+}
+
+void tst_Compiled::precomputedTransitions()
+{
+    PrecomputedTransitions stateMachine;
+    QSignalSpy stableStateSpy(&stateMachine, SIGNAL(reachedStableState()));
+    stateMachine.start();
+    QTRY_COMPARE(stableStateSpy.size(), 1);
+
+    stateMachine.submitEvent("go");
+    QTRY_COMPARE(stableStateSpy.size(), 2);
+    QVERIFY(stateMachine.isActive(QStringLiteral("l1")));
+    QVERIFY(stateMachine.isActive(QStringLiteral("r1")));
+    QCOMPARE(stateMachine.dataModel()->scxmlProperty(QStringLiteral("entries")).toString(),
+             QStringLiteral("r"));
+
+    stateMachine.submitEvent("next");
+    QTRY_COMPARE(stableStateSpy.size(), 3);
+    QVERIFY(stateMachine.isActive(QStringLiteral("l2")));
+    QVERIFY(stateMachine.isActive(QStringLiteral("r1")));
+
+    stateMachine.submitEvent("pause");
+    QTRY_COMPARE(stableStateSpy.size(), 4);
+    QCOMPARE(stateMachine.activeStateNames(false), QStringList(QLatin1String("paused")));
+
+    // Targeting a history state is not precomputed, but enters the same states as before.
+    stateMachine.submitEvent("resume");
+    QTRY_COMPARE(stableStateSpy.size(), 5);
+    QVERIFY(stateMachine.isActive(QStringLiteral("l2")));
+    QVERIFY(stateMachine.isActive(QStringLiteral("r1")));
+    QCOMPARE(stateMachine.dataModel()->scxmlProperty(QStringLiteral("entries")).toString(),
+             QStringLiteral("rr"));
+}
+
+void tst_Compiled::inlineSubMachines()
+{
+    // The tables of the sub-documents are built concurrently.
+    InlineSubMachines stateMachine;
+    QSignalSpy finishedSpy(&stateMachine, SIGNAL(finished()));
+    stateMachine.start();
+    QTRY_COMPARE(finishedSpy.size(), 1);
+    QCOMPARE(stateMachine.dataModel()->scxmlProperty(QStringLiteral("sum")).toInt(), 111);
+}
+
 QTEST_MAIN(tst_Compiled)
 
 #include "tst_compiled.moc"
@@ -0,0 +1,22 @@
+// Copyright (C) 2023 The Qt Company Ltd.
+// SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
+
+#ifndef TYPEDDATAMODEL_H
+#define TYPEDDATAMODEL_H
+
+#include <QtScxml/qscxmlcppdatamodel.h>
+
+class TypedDataModel: public QScxmlCppDataModel
+{
+    Q_OBJECT
+    Q_SCXML_TYPED_DATAMODEL
+
+public:
+    int counterValue() const { return counter; }
+
+private:
+    int counter = 0;
+    QString label;
+};
+
+#endif // TYPEDDATAMODEL_H
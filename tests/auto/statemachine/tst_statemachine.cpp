@@ -8,6 +8,9 @@
 #include <QtScxml/qscxmlcompiler.h>
 #include <QtScxml/qscxmlstatemachine.h>
 #include <QtScxml/qscxmlinvokableservice.h>
+#include <QtScxml/qscxmllogsink.h>
+#include <QtScxml/private/qscxmlcompiledchart_p.h>
+#include <QtScxml/private/qscxmlcompiler_p.h>
 #include <QtScxml/private/qscxmlstatemachine_p.h>
 #include <QtScxml/QScxmlNullDataModel>
 
@@ -36,6 +39,22 @@ private Q_SLOTS:
 
     void multipleInvokableServices(); // QTBUG-61484
     void logWithoutExpr();
+    void logSink();
+    void eventVariableUsed_data();
+    void eventVariableUsed();
+    void eventVariableReadIndirectly();
+    void dataInitialization();
+    void eventData_data();
+    void eventData();
+    void inPredicate_data();
+    void inPredicate();
+    void foreachLoop();
+    void compiledChart();
+    void compiledChartSubDocuments();
+    void chartCache();
+    void constantFolding();
+    void attributeChecks_data();
+    void attributeChecks();
 
     void bindings();
 };
@@ -436,6 +455,598 @@ void tst_StateMachine::logWithoutExpr()
     QTRY_COMPARE(logSpy.size(), 1);
 }
 
+class RecordingLogSink : public QScxmlLogSink
+{
+public:
+    void log(const QList<Record> &records) override
+    {
+        ++batches;
+        this->records += records;
+    }
+
+    int batches = 0;
+    QList<Record> records;
+};
+
+void tst_StateMachine::logSink()
+{
+    QScopedPointer<QScxmlStateMachine> stateMachine(
+                QScxmlStateMachine::fromFile(QString(":/tst_statemachine/emptylog.scxml")));
+    QVERIFY(!stateMachine.isNull());
+    RecordingLogSink sink;
+    stateMachine->setLogSink(&sink);
+    QCOMPARE(stateMachine->logSink(), &sink);
+    QTest::ignoreMessage(QtDebugMsg, "\"Hi2\" : \"\"");
+    stateMachine->start();
+    QTRY_COMPARE(sink.records.size(), 1);
+    QCOMPARE(sink.batches, 1);
+    QCOMPARE(sink.records.first().label, QLatin1String("Hi2"));
+    QVERIFY(sink.records.first().message.isEmpty());
+    QVERIFY(sink.records.first().timestamp > 0);
+    stateMachine->setLogSink(nullptr);
+}
+
+void tst_StateMachine::eventVariableUsed_data()
+{
+    QTest::addColumn<QByteArray>("content");
+    QTest::addColumn<bool>("used");
+
+    const QByteArray header = "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+                              "datamodel=\"ecmascript\">";
+    QTest::newRow("unused")
+            << header + "<state id=\"a\"><transition event=\"e\" cond=\"x_event > 1\"/></state>"
+                        "<datamodel><data id=\"x_event\" expr=\"0\"/></datamodel></scxml>"
+            << false;
+    QTest::newRow("condition")
+            << header + "<state id=\"a\"><transition event=\"e\" cond=\"_event.data > 1\"/>"
+                        "</state></scxml>"
+            << true;
+    QTest::newRow("assign")
+            << header + "<datamodel><data id=\"x\"/></datamodel><state id=\"a\"><onentry>"
+                        "<assign location=\"x\" expr=\"_event\"/></onentry></state></scxml>"
+            << true;
+    QTest::newRow("script")
+            << header + "<state id=\"a\"><onentry><script>var y = eval('1');</script>"
+                        "</onentry></state></scxml>"
+            << true;
+}
+
+void tst_StateMachine::eventVariableUsed()
+{
+    QFETCH(QByteArray, content);
+    QFETCH(bool, used);
+
+    QBuffer buffer(&content);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QScopedPointer<QScxmlStateMachine> stateMachine(QScxmlStateMachine::fromData(&buffer));
+    QVERIFY(!stateMachine.isNull());
+    QCOMPARE(stateMachine->parseErrors().size(), 0);
+
+    auto stateTable = reinterpret_cast<const QScxmlExecutableContent::StateTable *>(
+                stateMachine->tableData()->stateMachineTable());
+    QCOMPARE(bool(stateTable->flags & QScxmlExecutableContent::StateTable::EventVariableUsed),
+             used);
+}
+
+void tst_StateMachine::eventVariableReadIndirectly()
+{
+    // None of the expressions mentions _event, so it is only bound when it is read.
+    QByteArray content =
+            "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+            "datamodel=\"ecmascript\" initial=\"a\">"
+            "<datamodel><data id=\"name\"/><data id=\"value\"/></datamodel>"
+            "<state id=\"a\">"
+            "<transition event=\"skip\"/>"
+            "<transition event=\"read\" target=\"b\">"
+            "<assign location=\"name\" expr=\"Function('return _' + 'event')().name\"/>"
+            "<assign location=\"value\" expr=\"Function('return _' + 'event')().data.value\"/>"
+            "</transition></state><state id=\"b\"/></scxml>";
+
+    QScopedPointer<QScxmlStateMachine> stateMachine(QScxmlStateMachine::fromData(content));
+    QVERIFY(!stateMachine.isNull());
+    QCOMPARE(stateMachine->parseErrors().size(), 0);
+    auto stateTable = reinterpret_cast<const QScxmlExecutableContent::StateTable *>(
+                stateMachine->tableData()->stateMachineTable());
+    QVERIFY(!(stateTable->flags & QScxmlExecutableContent::StateTable::EventVariableUsed));
+
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("a")));
+    for (int i = 0; i < 3; ++i) {
+        stateMachine->submitEvent(QStringLiteral("skip"),
+                                  QVariantMap({{ QStringLiteral("value"), i }}));
+    }
+    stateMachine->submitEvent(QStringLiteral("read"),
+                              QVariantMap({{ QStringLiteral("value"), 42 }}));
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("b")));
+
+    QScxmlDataModel *dataModel = stateMachine->dataModel();
+    QCOMPARE(dataModel->scxmlProperty(QStringLiteral("name")).toString(), QStringLiteral("read"));
+    QCOMPARE(dataModel->scxmlProperty(QStringLiteral("value")).toInt(), 42);
+}
+
+void tst_StateMachine::dataInitialization()
+{
+    QByteArray content =
+            "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+            "datamodel=\"ecmascript\" initial=\"a\">"
+            "<datamodel><data id=\"__proto__\"/><data id=\"x\" expr=\"1\"/>"
+            "<data id=\"y\" expr=\"2\"/></datamodel>"
+            "<state id=\"a\"/></scxml>";
+
+    QScopedPointer<QScxmlStateMachine> stateMachine(QScxmlStateMachine::fromData(content));
+    QVERIFY(!stateMachine.isNull());
+    QCOMPARE(stateMachine->parseErrors().size(), 0);
+    stateMachine->setInitialValues(QVariantMap({{ QStringLiteral("x"), 5 }}));
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("a")));
+
+    QScxmlDataModel *dataModel = stateMachine->dataModel();
+    QCOMPARE(dataModel->scxmlProperty(QStringLiteral("x")).toInt(), 5);
+    QCOMPARE(dataModel->scxmlProperty(QStringLiteral("y")).toInt(), 2);
+    // The data is defined on the data model, rather than assigned, so the inherited accessor
+    // is shadowed instead of being called.
+    QVERIFY(!dataModel->scxmlProperty(QStringLiteral("__proto__")).isValid());
+}
+
+void tst_StateMachine::eventData_data()
+{
+    QTest::addColumn<QVariant>("data");
+
+    QVariantMap smallMap;
+    smallMap.insert(QStringLiteral("a"), 1);
+    QVariantMap largeMap;
+    for (int i = 0; i < 1000; ++i)
+        largeMap.insert(QStringLiteral("k%1").arg(i), i);
+    largeMap.insert(QStringLiteral("a"), 1);
+    QVariantHash hash;
+    hash.insert(QStringLiteral("a"), 1);
+    QJsonObject object;
+    object.insert(QStringLiteral("a"), 1);
+
+    QTest::newRow("map") << QVariant(smallMap);
+    QTest::newRow("large map") << QVariant(largeMap);
+    QTest::newRow("hash") << QVariant(hash);
+    QTest::newRow("json object") << QVariant(object);
+    QTest::newRow("json document") << QVariant(QJsonDocument(object));
+    QTest::newRow("json string") << QVariant(QStringLiteral(" {\"a\": 1}"));
+    QTest::newRow("json bytes") << QVariant(QByteArray("{\"a\": 1}"));
+    QTest::newRow("large json string")
+            << QVariant(QStringLiteral("{\"a\": 1, \"b\": \"%1\"}")
+                        .arg(QString(10000, QLatin1Char('b'))));
+}
+
+void tst_StateMachine::eventData()
+{
+    QFETCH(QVariant, data);
+
+    QByteArray content =
+            "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+            "datamodel=\"ecmascript\" initial=\"a\">"
+            "<state id=\"a\">"
+            "<transition event=\"e\" cond=\"_event.data.a === 1\" target=\"b\"/>"
+            "<transition event=\"e\" target=\"c\"/>"
+            "</state><state id=\"b\"/><state id=\"c\"/></scxml>";
+    QBuffer buffer(&content);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QScopedPointer<QScxmlStateMachine> stateMachine(QScxmlStateMachine::fromData(&buffer));
+    QVERIFY(!stateMachine.isNull());
+    QCOMPARE(stateMachine->parseErrors().size(), 0);
+
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("a")));
+    stateMachine->submitEvent(QStringLiteral("e"), data);
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("b")));
+}
+
+void tst_StateMachine::inPredicate_data()
+{
+    QTest::addColumn<QByteArray>("dataModel");
+    QTest::addColumn<QByteArray>("unknownState");
+
+    QTest::newRow("null") << QByteArray("null") << QByteArray("In(nowhere)");
+    QTest::newRow("ecmascript") << QByteArray("ecmascript") << QByteArray("In('nowhere')");
+}
+
+void tst_StateMachine::inPredicate()
+{
+    QFETCH(QByteArray, dataModel);
+    QFETCH(QByteArray, unknownState);
+
+    const QByteArray in = dataModel == "null" ? "In(x)" : "In('x')";
+    QByteArray content =
+            "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+            "datamodel=\"" + dataModel + "\" initial=\"p\">"
+            "<parallel id=\"p\">"
+            "<state id=\"p1\" initial=\"a\"><state id=\"a\">"
+            "<transition event=\"e\" cond=\"" + unknownState + "\" target=\"c\"/>"
+            "<transition event=\"e\" cond=\"" + in + "\" target=\"b\"/>"
+            "</state><state id=\"b\"/><state id=\"c\"/></state>"
+            "<state id=\"p2\" initial=\"x\"><state id=\"x\">"
+            "<transition event=\"e\" target=\"y\"/>"
+            "</state><state id=\"y\"/></state>"
+            "</parallel></scxml>";
+    QBuffer buffer(&content);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QScopedPointer<QScxmlStateMachine> stateMachine(QScxmlStateMachine::fromData(&buffer));
+    QVERIFY(!stateMachine.isNull());
+    QCOMPARE(stateMachine->parseErrors().size(), 0);
+
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("a")));
+    QVERIFY(stateMachine->isActive(QStringLiteral("x")));
+    QVERIFY(!stateMachine->isActive(QStringLiteral("nowhere")));
+
+    // Conditions are evaluated before any transition is taken.
+    stateMachine->submitEvent(QStringLiteral("e"));
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("b")));
+    QVERIFY(!stateMachine->isActive(QStringLiteral("x")));
+    QVERIFY(stateMachine->isActive(QStringLiteral("y")));
+}
+
+void tst_StateMachine::foreachLoop()
+{
+    // The body changes the array, but the loop still sees the original items.
+    QByteArray content =
+            "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+            "datamodel=\"ecmascript\" initial=\"a\">"
+            "<datamodel><data id=\"arr\" expr=\"[1, 2, 3]\"/><data id=\"sum\" expr=\"0\"/>"
+            "</datamodel>"
+            "<state id=\"a\"><onentry>"
+            "<foreach array=\"arr\" item=\"item\" index=\"index\">"
+            "<assign location=\"sum\" expr=\"sum + item * (index + 1)\"/>"
+            "<script>if (index === 0) arr[1] = 100;</script>"
+            "</foreach></onentry>"
+            "<transition cond=\"sum === 14 &amp;&amp; item === 3 &amp;&amp; index === 2\" "
+            "target=\"pass\"/>"
+            "<transition target=\"fail\"/>"
+            "</state><state id=\"pass\"/><state id=\"fail\"/></scxml>";
+    QBuffer buffer(&content);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QScopedPointer<QScxmlStateMachine> stateMachine(QScxmlStateMachine::fromData(&buffer));
+    QVERIFY(!stateMachine.isNull());
+    QCOMPARE(stateMachine->parseErrors().size(), 0);
+
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("pass")));
+}
+
+void tst_StateMachine::compiledChart()
+{
+    QByteArray content =
+            "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+            "name=\"Compiled\" datamodel=\"ecmascript\" initial=\"running\">"
+            "<datamodel><data id=\"answer\" expr=\"0\"/></datamodel>"
+            "<state id=\"running\">"
+            "<invoke><content>"
+            "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+            "datamodel=\"ecmascript\">"
+            "<state id=\"child\"><onentry>"
+            "<send event=\"ready\" target=\"#_parent\"><param name=\"value\" expr=\"42\"/>"
+            "</send></onentry></state></scxml>"
+            "</content></invoke>"
+            "<transition event=\"ready\" target=\"pass\">"
+            "<assign location=\"answer\" expr=\"_event.data.value\"/></transition>"
+            "</state><state id=\"pass\"/></scxml>";
+    QBuffer buffer(&content);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QXmlStreamReader reader(&buffer);
+    QScxmlCompiler compiler(&reader);
+    QScopedPointer<QScxmlStateMachine> compiled(compiler.compile());
+    QCOMPARE(compiler.errors().size(), 0);
+
+    QScxmlInternal::CompiledChartWriter writer;
+    QString error;
+    QVERIFY(writer.addDocument(QScxmlCompilerPrivate::get(&compiler)->scxmlDocument(), &error));
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write(writer.data());
+    file.close();
+
+    QScopedPointer<QScxmlStateMachine> stateMachine(
+                QScxmlStateMachine::fromCompiledFile(file.fileName()));
+    QVERIFY(!stateMachine.isNull());
+    QCOMPARE(stateMachine->parseErrors().size(), 0);
+    QCOMPARE(stateMachine->name(), QStringLiteral("Compiled"));
+    QCOMPARE(stateMachine->stateNames(), QStringList({ "running", "pass" }));
+
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("pass")));
+    QCOMPARE(stateMachine->property("pass").toBool(), true);
+    QCOMPARE(stateMachine->dataModel()->scxmlProperty(QStringLiteral("answer")).toInt(), 42);
+
+    // Anything else is rejected.
+    QScopedPointer<QScxmlStateMachine> invalid(
+                QScxmlStateMachine::fromCompiledFile(QString(":/tst_statemachine/invoke.scxml")));
+    QVERIFY(!invalid.isNull());
+    QCOMPARE(invalid->parseErrors().size(), 1);
+
+    // So are charts with indices that point outside of them.
+    using namespace QScxmlInternal::CompiledChart;
+    QByteArray data = writer.data();
+    const qint32 chartOffset = reinterpret_cast<const qint32 *>(
+                data.constData() + sizeof(FileHeader))[0];
+    const ChartHeader *chartHeader = reinterpret_cast<const ChartHeader *>(
+                data.constData() + chartOffset);
+    auto stateTable = reinterpret_cast<QScxmlExecutableContent::StateTable *>(
+                data.data() + chartOffset + chartHeader->sections[StateMachineTableSection].offset);
+    auto states = reinterpret_cast<QScxmlExecutableContent::StateTable::State *>(
+                reinterpret_cast<int *>(stateTable) + stateTable->stateOffset);
+    states[stateTable->stateCount - 1].parent = stateTable->stateCount;
+
+    QTemporaryFile corruptFile;
+    QVERIFY(corruptFile.open());
+    corruptFile.write(data);
+    corruptFile.close();
+
+    QScopedPointer<QScxmlStateMachine> corrupt(
+                QScxmlStateMachine::fromCompiledFile(corruptFile.fileName()));
+    QVERIFY(!corrupt.isNull());
+    QCOMPARE(corrupt->parseErrors().size(), 1);
+}
+
+void tst_StateMachine::compiledChartSubDocuments()
+{
+    // The tables of the sub-documents are built concurrently.
+    auto child = [](int value) {
+        return "<invoke><content>"
+               "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+               "datamodel=\"ecmascript\"><final id=\"f\"><onentry>"
+               "<send event=\"value\" target=\"#_parent\">"
+               "<param name=\"value\" expr=\"" + QByteArray::number(value) + "\"/>"
+               "</send></onentry></final></scxml>"
+               "</content></invoke>";
+    };
+    QByteArray content =
+            "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+            "datamodel=\"ecmascript\" initial=\"running\">"
+            "<datamodel><data id=\"sum\" expr=\"0\"/></datamodel>"
+            "<state id=\"running\">" + child(1) + child(10) + child(100) + child(1000)
+            + "<transition event=\"value\">"
+              "<assign location=\"sum\" expr=\"sum + _event.data.value\"/></transition>"
+              "<transition cond=\"sum === 1111\" target=\"pass\"/>"
+              "</state><final id=\"pass\"/></scxml>";
+    QBuffer buffer(&content);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QXmlStreamReader reader(&buffer);
+    QScxmlCompiler compiler(&reader);
+    QScopedPointer<QScxmlStateMachine> compiled(compiler.compile());
+    QCOMPARE(compiler.errors().size(), 0);
+
+    QScxmlInternal::CompiledChartWriter writer;
+    QString error;
+    QVERIFY(writer.addDocument(QScxmlCompilerPrivate::get(&compiler)->scxmlDocument(), &error));
+
+    QTemporaryFile file;
+    QVERIFY(file.open());
+    file.write(writer.data());
+    file.close();
+
+    QScopedPointer<QScxmlStateMachine> stateMachine(
+                QScxmlStateMachine::fromCompiledFile(file.fileName()));
+    QVERIFY(!stateMachine.isNull());
+    QCOMPARE(stateMachine->parseErrors().size(), 0);
+
+    QSignalSpy finishedSpy(stateMachine.data(), SIGNAL(finished()));
+    stateMachine->start();
+    QTRY_COMPARE(finishedSpy.size(), 1);
+    QCOMPARE(stateMachine->dataModel()->scxmlProperty(QStringLiteral("sum")).toInt(), 1111);
+}
+
+void tst_StateMachine::chartCache()
+{
+    class CountingLoader: public QScxmlCompiler::Loader
+    {
+    public:
+        QByteArray load(const QString &name, const QString &, QStringList *) override
+        {
+            ++loads[name];
+            if (name == QLatin1String("chartcache.scxml")) {
+                return "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+                       "datamodel=\"ecmascript\"><final id=\"f\"><onentry>"
+                       "<script src=\"chartcache.js\"/></onentry></final></scxml>";
+            }
+            return "var x = 1;";
+        }
+
+        QHash<QString, int> loads;
+    };
+
+    QByteArray content =
+            "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+            "datamodel=\"ecmascript\" initial=\"a\">"
+            "<datamodel><data id=\"count\" expr=\"0\"/></datamodel>"
+            "<state id=\"a\"><invoke srcexpr=\"'chartcache.scxml'\"/>"
+            "<transition event=\"done.invoke\" cond=\"count &lt; 2\" target=\"a\">"
+            "<assign location=\"count\" expr=\"count + 1\"/></transition>"
+            "<transition event=\"done.invoke\" target=\"pass\"/>"
+            "</state><state id=\"pass\"/></scxml>";
+    CountingLoader loader;
+    auto run = [&](CountingLoader *loader) {
+        QBuffer buffer(&content);
+        QVERIFY(buffer.open(QIODevice::ReadOnly));
+        QScopedPointer<QScxmlStateMachine> stateMachine(QScxmlStateMachine::fromData(&buffer));
+        QVERIFY(!stateMachine.isNull());
+        QCOMPARE(stateMachine->parseErrors().size(), 0);
+        stateMachine->setLoader(loader);
+        stateMachine->start();
+        QTRY_VERIFY(stateMachine->isActive(QStringLiteral("pass")));
+    };
+
+    // The chart is loaded every time it is invoked, but only compiled once.
+    QScxmlCompiler::clearChartCache();
+    run(&loader);
+    QCOMPARE(loader.loads.value(QStringLiteral("chartcache.scxml")), 3);
+    QCOMPARE(loader.loads.value(QStringLiteral("chartcache.js")), 1);
+
+    run(&loader);
+    QCOMPARE(loader.loads.value(QStringLiteral("chartcache.js")), 1);
+
+    QScxmlCompiler::invalidateCachedChart(QStringLiteral("chartcache.scxml"));
+    run(&loader);
+    QCOMPARE(loader.loads.value(QStringLiteral("chartcache.js")), 2);
+
+    // Invalidating a file that the chart includes evicts the chart, too.
+    QScxmlCompiler::invalidateCachedChart(QStringLiteral("chartcache.js"));
+    run(&loader);
+    QCOMPARE(loader.loads.value(QStringLiteral("chartcache.js")), 3);
+
+    // Another loader can resolve the included files differently.
+    {
+        CountingLoader otherLoader;
+        run(&otherLoader);
+        QCOMPARE(otherLoader.loads.value(QStringLiteral("chartcache.js")), 1);
+    }
+    run(&loader);
+    QCOMPARE(loader.loads.value(QStringLiteral("chartcache.js")), 3);
+
+    // The default loader cannot tell when an included file changes, so charts that include files
+    // are compiled again every time they are loaded through it.
+    QTemporaryDir dir;
+    QVERIFY(dir.isValid());
+    auto writeFile = [&dir](const QString &name, const QByteArray &data) {
+        QFile file(dir.filePath(name));
+        QVERIFY(file.open(QIODevice::WriteOnly));
+        file.write(data);
+    };
+    writeFile(QStringLiteral("included.scxml"),
+              "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+              "datamodel=\"ecmascript\">"
+              "<datamodel><data id=\"version\" src=\"included.txt\"/></datamodel>"
+              "<final id=\"f\"><onentry><send event=\"version\" target=\"#_parent\">"
+              "<param name=\"version\" expr=\"version\"/></send></onentry></final></scxml>");
+    QByteArray including =
+            "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+            "datamodel=\"ecmascript\" initial=\"a\">"
+            "<datamodel><data id=\"version\" expr=\"0\"/></datamodel>"
+            "<state id=\"a\"><invoke srcexpr=\"'"
+            + dir.filePath(QStringLiteral("included.scxml")).toUtf8() + "'\"/>"
+            "<transition event=\"version\">"
+            "<assign location=\"version\" expr=\"_event.data.version\"/></transition>"
+            "<transition event=\"done.invoke\" target=\"pass\"/>"
+            "</state><state id=\"pass\"/></scxml>";
+    for (int version : { 1, 2 }) {
+        writeFile(QStringLiteral("included.txt"), QByteArray::number(version));
+        QBuffer buffer(&including);
+        QVERIFY(buffer.open(QIODevice::ReadOnly));
+        QScopedPointer<QScxmlStateMachine> stateMachine(QScxmlStateMachine::fromData(&buffer));
+        QVERIFY(!stateMachine.isNull());
+        QCOMPARE(stateMachine->parseErrors().size(), 0);
+        stateMachine->start();
+        QTRY_VERIFY(stateMachine->isActive(QStringLiteral("pass")));
+        QCOMPARE(stateMachine->dataModel()->scxmlProperty(QStringLiteral("version")).toInt(),
+                 version);
+    }
+
+    const qsizetype limit = QScxmlCompiler::chartCacheLimit();
+    QScxmlCompiler::setChartCacheLimit(0);
+    QCOMPARE(QScxmlCompiler::chartCacheLimit(), 0);
+    QScxmlCompiler::setChartCacheLimit(limit);
+}
+
+void tst_StateMachine::constantFolding()
+{
+    QByteArray content =
+            "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+            "datamodel=\"ecmascript\" initial=\"a\">"
+            "<datamodel><data id=\"x\" expr=\"0\"/><data id=\"y\" expr=\"0\"/>"
+            "<data id=\"z\" expr=\"0\"/></datamodel>"
+            "<state id=\"a\"><onentry>"
+            "<if cond=\"1 == 2\"><assign location=\"x\" expr=\"1\"/>"
+            "<elseif cond=\"!false\"/><assign location=\"x\" expr=\"2 * 3 + 1\"/>"
+            "<else/><assign location=\"x\" expr=\"3\"/></if>"
+            "<assign location=\"y\" expr=\"1 - -1\"/>"
+            "<assign location=\"z\" expr=\"1--1\"/>"
+            "</onentry>"
+            "<transition cond=\"false\" target=\"fail\"/>"
+            "<transition cond=\"--1\" target=\"fail\"/>"
+            "<transition cond=\"In('a')\" target=\"pass\"/>"
+            "</state><state id=\"pass\"/><state id=\"fail\"/></scxml>";
+    QBuffer buffer(&content);
+    QVERIFY(buffer.open(QIODevice::ReadOnly));
+    QXmlStreamReader reader(&buffer);
+    QScxmlCompiler compiler(&reader);
+    QScopedPointer<QScxmlStateMachine> stateMachine(compiler.compile());
+    QCOMPARE(compiler.errors().size(), 0);
+
+    // The first transition to "fail" is gone, and the one to "pass" is unconditional. "--1" is a
+    // syntax error, so that condition is left to the data model.
+    DocumentModel::ScxmlDocument *doc = QScxmlCompilerPrivate::get(&compiler)->scxmlDocument();
+    QVERIFY(doc);
+    QCOMPARE(doc->allTransitions.size(), 3);
+    QStringList conditions;
+    for (DocumentModel::Transition *transition : std::as_const(doc->allTransitions)) {
+        if (!transition->condition.isNull())
+            conditions.append(*transition->condition);
+    }
+    QCOMPARE(conditions, QStringList({ QStringLiteral("--1") }));
+
+    // Only the assignment of the branch that is always taken is left, with a folded expression.
+    // "1 - -1" is folded, but "1--1" is a syntax error and stays as it is.
+    DocumentModel::State *a = doc->allStates.first()->asState();
+    QVERIFY(a);
+    QCOMPARE(a->onEntry.size(), 1);
+    QCOMPARE(a->onEntry.first()->size(), 3);
+    QStringList expressions;
+    for (DocumentModel::Instruction *instruction : std::as_const(*a->onEntry.first())) {
+        DocumentModel::Assign *assign = instruction->asAssign();
+        QVERIFY(assign);
+        expressions.append(assign->expr);
+    }
+    QCOMPARE(expressions, QStringList({ QStringLiteral("7"), QStringLiteral("2"),
+                                        QStringLiteral("1--1") }));
+
+    stateMachine->start();
+    QTRY_VERIFY(stateMachine->isActive(QStringLiteral("pass")));
+    QCOMPARE(stateMachine->dataModel()->scxmlProperty(QStringLiteral("x")).toInt(), 7);
+    QCOMPARE(stateMachine->dataModel()->scxmlProperty(QStringLiteral("y")).toInt(), 2);
+    QCOMPARE(stateMachine->dataModel()->scxmlProperty(QStringLiteral("z")).toInt(), 0);
+}
+
+void tst_StateMachine::attributeChecks_data()
+{
+    QTest::addColumn<QByteArray>("content");
+    QTest::addColumn<QString>("error");
+
+    const QByteArray header =
+            "<scxml xmlns=\"http://www.w3.org/2005/07/scxml\" version=\"1.0\" "
+            "xmlns:other=\"urn:other\" initial=\"a\">";
+    QTest::newRow("valid")
+            << header + "<state id=\"a\" other:color=\"red\">"
+                        "<transition event=\"e\" target=\"a\" type=\"internal\"/>"
+                        "</state></scxml>"
+            << QString();
+    QTest::newRow("unexpected")
+            << header + "<state id=\"a\" event=\"e\"/></scxml>"
+            << QStringLiteral("<Unknown File>:1:%1: error: Unexpected attribute 'event'");
+    QTest::newRow("unknown")
+            << header + "<state id=\"a\"><transition evnt=\"e\"/></state></scxml>"
+            << QStringLiteral("<Unknown File>:1:%1: error: Unexpected attribute 'evnt'");
+    QTest::newRow("missing")
+            << header + "<state id=\"a\"><onentry><foreach index=\"i\"/></onentry></state></scxml>"
+            << QStringLiteral("<Unknown File>:1:%1: error: Missing required attributes: 'array', 'item'");
+    QTest::newRow("unknown element")
+            << header + "<state id=\"a\"><stat id=\"b\"/></state></scxml>"
+            << QStringLiteral("<Unknown File>:1:%1: error: Unknown element stat");
+}
+
+void tst_StateMachine::attributeChecks()
+{
+    QFETCH(QByteArray, content);
+    QFETCH(QString, error);
+
+    QScopedPointer<QScxmlStateMachine> stateMachine(QScxmlStateMachine::fromData(content));
+    QVERIFY(!stateMachine.isNull());
+    const QList<QScxmlError> errors = stateMachine->parseErrors();
+    if (error.isEmpty()) {
+        QCOMPARE(errors.size(), 0);
+        return;
+    }
+
+    QVERIFY(!errors.isEmpty());
+    QCOMPARE(errors.first().toString(), error.arg(errors.first().column()));
+}
+
 void tst_StateMachine::bindings()
 {
     // -- QScxmlStateMachine::initialized
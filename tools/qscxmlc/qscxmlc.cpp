@@ -1,6 +1,7 @@
 // Copyright (C) 2016 The Qt Company Ltd.
 // SPDX-License-Identifier: LicenseRef-Qt-Commercial OR GPL-3.0-only WITH Qt-GPL-exception-1.0
 
+#include <QtScxml/private/qscxmlcompiledchart_p.h>
 #include <QtScxml/private/qscxmlcompiler_p.h>
 #include <QtScxml/qscxmltabledata.h>
 #include "scxmlcppdumper.h"
@@ -23,7 +24,9 @@ enum {
     CannotOpenOutputHeaderFileError = -5,
     CannotOpenOutputCppFileError = -6,
     ScxmlVerificationError = -7,
-    NoTextCodecError = -8
+    NoTextCodecError = -8,
+    CannotOpenOutputCompiledChartFileError = -9,
+    UnsupportedDataModelError = -10
 };
 
 int write(TranslationUnit *tu)
@@ -64,6 +67,28 @@ int write(TranslationUnit *tu)
     return NoError;
 }
 
+int writeCompiledChart(TranslationUnit *tu, const QString &fileName)
+{
+    QTextStream errs(stderr, QIODevice::WriteOnly);
+
+    QScxmlInternal::CompiledChartWriter writer;
+    writer.setPrecomputeTransitions(tu->precomputeTransitions);
+    QString error;
+    if (!writer.addDocument(tu->mainDocument, &error)) {
+        errs << QStringLiteral("Error: %1").arg(error) << Qt::endl;
+        return UnsupportedDataModelError;
+    }
+
+    QFile out(fileName);
+    if (!out.open(QFile::WriteOnly)) {
+        errs << QStringLiteral("Error: cannot open '%1': %2").arg(out.fileName(), out.errorString()) << Qt::endl;
+        return CannotOpenOutputCompiledChartFileError;
+    }
+    out.write(writer.data());
+    out.close();
+    return NoError;
+}
+
 static void collectAllDocuments(DocumentModel::ScxmlDocument *doc,
                                 QList<DocumentModel::ScxmlDocument *> *docs)
 {
@@ -99,6 +124,17 @@ int run(const QStringList &arguments)
                        QCoreApplication::translate("main", "name"));
     QCommandLineOption optionStateMethods(QLatin1String("statemethods"),
                        QCoreApplication::translate("main", "Generate read and notify methods for states"));
+    QCommandLineOption optionPrecompileEcmaScript(QLatin1String("precompile-ecmascript"),
+                       QCoreApplication::translate("main", "Pre-compile the expressions of ECMAScript data models"));
+    QCommandLineOption optionEvaluatorTable(QLatin1String("evaluator-table"),
+                       QCoreApplication::translate("main", "Call the conditions of C++ data models directly through a table"));
+    QCommandLineOption optionCompiledChart(QLatin1String("compiled-chart"),
+                       QCoreApplication::translate("main", "Generate a compiled chart <file> instead of C++ code."),
+                       QCoreApplication::translate("main", "file"));
+    QCommandLineOption optionPrecomputeTransitions(QLatin1String("precompute-transitions"),
+                       QCoreApplication::translate("main", "Precompute the states that transitions without history exit and enter"));
+    QCommandLineOption optionPruneUnreachable(QLatin1String("prune-unreachable"),
+                       QCoreApplication::translate("main", "Remove states and transitions that can never be active or taken"));
 
     cmdParser.addPositionalArgument(QLatin1String("input"),
                        QCoreApplication::translate("main", "Input SCXML file."));
@@ -108,6 +144,11 @@ int run(const QStringList &arguments)
     cmdParser.addOption(optionOutputSourceName);
     cmdParser.addOption(optionClassName);
     cmdParser.addOption(optionStateMethods);
+    cmdParser.addOption(optionPrecompileEcmaScript);
+    cmdParser.addOption(optionEvaluatorTable);
+    cmdParser.addOption(optionCompiledChart);
+    cmdParser.addOption(optionPrecomputeTransitions);
+    cmdParser.addOption(optionPruneUnreachable);
 
     cmdParser.process(arguments);
 
@@ -128,6 +169,9 @@ int run(const QStringList &arguments)
 
     TranslationUnit options;
     options.stateMethods = cmdParser.isSet(optionStateMethods);
+    options.precompileEcmaScript = cmdParser.isSet(optionPrecompileEcmaScript);
+    options.evaluatorTable = cmdParser.isSet(optionEvaluatorTable);
+    options.precomputeTransitions = cmdParser.isSet(optionPrecomputeTransitions);
     if (cmdParser.isSet(optionNamespace))
         options.namespaceName = cmdParser.value(optionNamespace);
     QString outFileName = cmdParser.value(optionOutputBaseName);
@@ -148,7 +192,13 @@ int run(const QStringList &arguments)
         return CannotOpenInputFileError;
     }
 
-    QXmlStreamReader reader(&file);
+    // Parse the mapped file in one go, rather than in chunks through the QIODevice.
+    const qint64 size = file.size();
+    const uchar *mapped = size > 0 ? file.map(0, size) : nullptr;
+    const QByteArray data = mapped
+            ? QByteArray::fromRawData(reinterpret_cast<const char *>(mapped), size)
+            : file.readAll();
+    QXmlStreamReader reader(data);
     QScxmlCompiler compiler(&reader);
     compiler.setFileName(file.fileName());
     compiler.compile();
@@ -170,6 +220,12 @@ int run(const QStringList &arguments)
         return ScxmlVerificationError;
     }
 
+    if (cmdParser.isSet(optionPruneUnreachable)) {
+        const QStringList warnings = QScxmlCompilerPrivate::pruneUnreachable(mainDoc);
+        for (const QString &warning : warnings)
+            errs << warning << Qt::endl;
+    }
+
     if (mainClassName.isEmpty())
         mainClassName = mainDoc->root->name;
     if (mainClassName.isEmpty()) {
@@ -207,6 +263,9 @@ int run(const QStringList &arguments)
         tu.classnameForDocument.insert(doc, name);
     }
 
+    if (cmdParser.isSet(optionCompiledChart))
+        return writeCompiledChart(&tu, cmdParser.value(optionCompiledChart));
+
     return write(&tu);
 }
 
@@ -10,6 +10,7 @@
 #include <QtCore/qbuffer.h>
 #include <QtCore/qfile.h>
 #include <QtCore/qresource.h>
+#include <QtCore/qthreadpool.h>
 
 #include <algorithm>
 #include <functional>
@@ -269,6 +270,35 @@ void generateTables(const GeneratedTableData &td, Replacements &replacements)
     }
 }
 
+// Generates a table with one function per condition, which the state machine calls instead of
+// the virtual evaluateToBool(). Each function calls evaluateToBool() of the data model class
+// non-virtually with a constant id, so that the compiler can reduce its switch to a single case.
+// The state machine only uses the table if its data model really is of that class.
+QString generateBoolEvaluatorTable(const GeneratedTableData::DataModelInfo &info,
+                                   const QString &dataModelClassName)
+{
+    if (info.boolEvaluators.isEmpty())
+        return QString();
+
+    QList<QScxmlExecutableContent::EvaluatorId> ids = info.boolEvaluators.keys();
+    std::sort(ids.begin(), ids.end());
+    QStringList entries;
+    for (int id = 0, count = ids.last() + 1; id < count; ++id) {
+        entries.append(info.boolEvaluators.contains(id)
+                ? QStringLiteral("            [](QScxmlDataModel *dataModel, bool *ok) {\n"
+                                 "                return static_cast<%1 *>(dataModel)->%1::evaluateToBool(%2, ok);\n"
+                                 "            }")
+                  .arg(dataModelClassName, QString::number(id))
+                : QStringLiteral("            nullptr"));
+    }
+    return QStringLiteral("\n        static const BoolEvaluator boolEvaluators[] = {\n%1\n"
+                          "        };\n"
+                          "        stateMachine.setBoolEvaluators(&%2::staticMetaObject, "
+                          "boolEvaluators, %3);")
+            .arg(entries.join(QStringLiteral(",\n")), dataModelClassName,
+                 QString::number(entries.size()));
+}
+
 void generateCppDataModelEvaluators(const GeneratedTableData::DataModelInfo &info,
                                     Replacements &replacements)
 {
@@ -305,6 +335,7 @@ void generateCppDataModelEvaluators(const GeneratedTableData::DataModelInfo &inf
     }
     replacements[QStringLiteral("evaluateToBoolCases")] = boolEvals;
 
+
     QString variantEvals;
     if (!info.variantEvaluators.isEmpty()) {
         variantEvals += switchStart;
@@ -336,6 +367,109 @@ void generateCppDataModelEvaluators(const GeneratedTableData::DataModelInfo &inf
     replacements[QStringLiteral("evaluateToVoidCases")] = voidEvals;
 }
 
+void generateTypedCppDataModel(const GeneratedTableData::DataModelInfo &info,
+                               Replacements &replacements)
+{
+    QHash<QString, QString> typeForName;
+    QStringList names;
+    for (const auto &data : info.typedData) {
+        if (!typeForName.contains(data.name))
+            names.append(data.name);
+        typeForName.insert(data.name, data.type);
+    }
+
+    QString assignments;
+    for (auto it = info.assignments.constBegin(), eit = info.assignments.constEnd(); it != eit;
+         ++it) {
+        if (!typeForName.contains(it->location))
+            continue;
+        if (assignments.isEmpty())
+            assignments += QStringLiteral("    switch (id) {\n");
+        assignments += QStringLiteral("    case %1:\n").arg(it.key());
+        assignments += QStringLiteral("        %1 = %2;\n").arg(it->location, it->expr);
+        assignments += QStringLiteral("        return;\n");
+    }
+    if (!assignments.isEmpty())
+        assignments += QStringLiteral("    default: break;\n    }");
+    replacements[QStringLiteral("evaluateAssignmentCases")] = assignments;
+
+    QString getters;
+    QString setters;
+    QStringList comparisons;
+    for (const QString &name : std::as_const(names)) {
+        const QString type = typeForName.value(name);
+        const QString comparison = QStringLiteral("name == QLatin1String(\"%1\")").arg(name);
+        comparisons.append(comparison);
+        getters += QStringLiteral("    if (%1)\n        return QVariant::fromValue(%2);\n")
+                .arg(comparison, name);
+        setters += QStringLiteral("    if (%1) {\n").arg(comparison);
+        setters += QStringLiteral("        static_assert(std::is_same_v<decltype(%1), %2>,\n"
+                                  "                      \"%1 is not declared with its qt:type %3\");\n")
+                .arg(name, type, cEscape(type));
+        setters += QStringLiteral("        if (!value.canConvert<%1>())\n"
+                                  "            return false;\n").arg(type);
+        setters += QStringLiteral("        %1 = value.value<%2>();\n"
+                                  "        return true;\n"
+                                  "    }\n").arg(name, type);
+    }
+    replacements[QStringLiteral("scxmlPropertyCases")] = getters;
+    replacements[QStringLiteral("setScxmlPropertyCases")] = setters;
+    replacements[QStringLiteral("hasScxmlPropertyCases")] =
+            QStringLiteral("    if (%1)\n        return true;\n")
+            .arg(comparisons.join(QStringLiteral("\n            || ")));
+}
+
+static QString generateFunctionArray(GeneratedTableData::EcmaScriptFunctionKind kind,
+                                     int count, std::function<QString(int)> expr)
+{
+    QString out = QStringLiteral("[");
+    for (int id = 0; id < count; ++id) {
+        const QString code = expr(id);
+        if (!code.isEmpty()) {
+            out += QStringLiteral("\n// %1\n").arg(id)
+                    + GeneratedTableData::ecmaScriptFunction(kind, code);
+        }
+        out += QLatin1Char(',');
+    }
+    out += QStringLiteral("\n]");
+    return out;
+}
+
+// Generates a JavaScript module that evaluates to one array of compiled functions per function
+// kind, indexed by evaluator or assignment id, stores it in the string table, and points the state
+// table at it. The ECMAScript data model then compiles all expressions with a single evaluate().
+// Scripts are not included, as their declarations have to end up in the global scope.
+void generateEcmaScriptModule(GeneratedTableData &td, const GeneratedTableData::DataModelInfo &info)
+{
+    const int evaluatorCount = td.theEvaluators.size();
+    const auto evaluators = [](const QHash<QScxmlExecutableContent::EvaluatorId, QString> &code) {
+        return [&code](int id) { return code.value(id); };
+    };
+
+    QStringList arrays;
+    arrays.resize(GeneratedTableData::FunctionKindCount);
+    arrays[GeneratedTableData::StringFunction] = generateFunctionArray(
+                GeneratedTableData::StringFunction, evaluatorCount,
+                evaluators(info.stringEvaluators));
+    arrays[GeneratedTableData::BoolFunction] = generateFunctionArray(
+                GeneratedTableData::BoolFunction, evaluatorCount,
+                evaluators(info.boolEvaluators));
+    arrays[GeneratedTableData::ValueFunction] = generateFunctionArray(
+                GeneratedTableData::ValueFunction, evaluatorCount,
+                evaluators(info.variantEvaluators));
+    arrays[GeneratedTableData::AssignmentFunction] = generateFunctionArray(
+                GeneratedTableData::AssignmentFunction, td.theAssignments.size(),
+                [&td](int id) { return td.string(td.theAssignments.at(id).expr); });
+
+    const QString module = QStringLiteral("'use strict';\n([\n")
+            + arrays.join(QStringLiteral(",\n")) + QStringLiteral("\n])");
+
+    auto stateTable = reinterpret_cast<QScxmlExecutableContent::StateTable *>(
+                td.theStateMachineTable.data());
+    stateTable->ecmaScriptModule = td.theStrings.size();
+    td.theStrings.append(module);
+}
+
 int createFactoryId(QStringList &factories, const QString &className,
                     const QString &namespacePrefix,
                     const QScxmlExecutableContent::InvokeInfo &invokeInfo,
@@ -406,23 +540,49 @@ void CppDumper::dump(TranslationUnit *unit)
     factories.resize(tables.size());
     auto classnameForDocument = m_translationUnit->classnameForDocument;
 
-    for (int i = 0, ei = docs.size(); i != ei; ++i) {
+    for (DocumentModel::ScxmlDocument *doc : std::as_const(docs))
+        classNames.append(mangleIdentifier(classnameForDocument.value(doc)));
+
+    // The documents don't depend on each other, so charts with sub-documents build their tables
+    // concurrently. Each job only writes to the entries for its own document.
+    GeneratedTableData *tableData = tables.data();
+    GeneratedTableData::MetaDataInfo *metaDataInfoData = metaDataInfos.data();
+    GeneratedTableData::DataModelInfo *dataModelInfoData = dataModelInfos.data();
+    QStringList *factoryData = factories.data();
+    auto buildTable = [&](int i) {
         auto doc = docs.at(i);
-        auto metaDataInfo = &metaDataInfos[i];
-        GeneratedTableData::build(doc, &tables[i], metaDataInfo, &dataModelInfos[i],
-                                  [this, &factories, i, &classnameForDocument, &namespacePrefix](
+        auto metaDataInfo = &metaDataInfoData[i];
+        GeneratedTableData::build(doc, &tableData[i], metaDataInfo, &dataModelInfoData[i],
+                                  [factoryData, i, &docs, &classNames, &namespacePrefix](
                 const QScxmlExecutableContent::InvokeInfo &invokeInfo,
                 const QList<QScxmlExecutableContent::StringId> &names,
                 const QList<QScxmlExecutableContent::ParameterInfo> &parameters,
                 const QSharedPointer<DocumentModel::ScxmlDocument> &content) -> int {
+            // The class names are mangled up front, as mangling is not thread-safe.
             QString className;
             if (invokeInfo.expr == QScxmlExecutableContent::NoEvaluator) {
-                className = mangleIdentifier(classnameForDocument.value(content.data()));
+                className = classNames.at(docs.indexOf(content.data()));
             }
-            return createFactoryId(factories[i], className, namespacePrefix,
+            return createFactoryId(factoryData[i], className, namespacePrefix,
                                    invokeInfo, names, parameters);
         });
-        classNames.append(mangleIdentifier(classnameForDocument.value(doc)));
+
+        if (m_translationUnit->precomputeTransitions)
+            GeneratedTableData::precomputeTransitionPaths(&tableData[i]);
+
+        if (m_translationUnit->precompileEcmaScript
+                && doc->root->dataModel == DocumentModel::Scxml::JSDataModel) {
+            generateEcmaScriptModule(tableData[i], dataModelInfoData[i]);
+        }
+    };
+
+    if (docs.size() == 1) {
+        buildTable(0);
+    } else {
+        QThreadPool pool;
+        for (int i = 0, ei = docs.size(); i != ei; ++i)
+            pool.start([&buildTable, i]() { buildTable(i); });
+        pool.waitForDone();
     }
 
     const QString headerName = QFileInfo(m_translationUnit->outHFileName).fileName();
@@ -437,13 +597,18 @@ void CppDumper::dump(TranslationUnit *unit)
         const GeneratedTableData &table = tables.at(i);
         DocumentModel::ScxmlDocument *doc = docs.at(i);
         writeClass(classNames.at(i), metaDataInfos.at(i));
-        writeImplBody(table, classNames.at(i), doc, factories.at(i), metaDataInfos.at(i));
+        writeImplBody(table, classNames.at(i), doc, factories.at(i), metaDataInfos.at(i),
+                      dataModelInfos.at(i));
 
         if (doc->root->dataModel == DocumentModel::Scxml::CppDataModel) {
             Replacements r;
             r[QStringLiteral("datamodel")] = doc->root->cppDataModelClassName;
             generateCppDataModelEvaluators(dataModelInfos.at(i), r);
             genTemplate(cpp, QStringLiteral(":/cppdatamodel.t"), r);
+            if (!dataModelInfos.at(i).typedData.isEmpty()) {
+                generateTypedCppDataModel(dataModelInfos.at(i), r);
+                genTemplate(cpp, QStringLiteral(":/typeddatamodel.t"), r);
+            }
         }
     }
 
@@ -550,7 +715,8 @@ void CppDumper::writeImplBody(const GeneratedTableData &table,
                               const QString &className,
                               DocumentModel::ScxmlDocument *doc,
                               const QStringList &factory,
-                              const GeneratedTableData::MetaDataInfo &info)
+                              const GeneratedTableData::MetaDataInfo &info,
+                              const GeneratedTableData::DataModelInfo &dataModelInfo)
 {
     QString dataModelField, dataModelInitialization;
     switch (doc->root->dataModel) {
@@ -569,6 +735,10 @@ void CppDumper::writeImplBody(const GeneratedTableData &table,
         dataModelField = QStringLiteral("// Data model %1 is set from outside.").arg(
                     doc->root->cppDataModelClassName);
         dataModelInitialization = dataModelField;
+        if (m_translationUnit->evaluatorTable) {
+            dataModelInitialization += generateBoolEvaluatorTable(
+                        dataModelInfo, doc->root->cppDataModelClassName);
+        }
         break;
     }
 
@@ -16,6 +16,9 @@ struct TranslationUnit
 {
     TranslationUnit()
         : stateMethods(false)
+        , precompileEcmaScript(false)
+        , evaluatorTable(false)
+        , precomputeTransitions(false)
         , mainDocument(nullptr)
     {}
 
@@ -23,6 +26,9 @@ struct TranslationUnit
     QString outHFileName, outCppFileName;
     QString namespaceName;
     bool stateMethods;
+    bool precompileEcmaScript;
+    bool evaluatorTable;
+    bool precomputeTransitions;
     DocumentModel::ScxmlDocument *mainDocument;
     QList<DocumentModel::ScxmlDocument *> allDocuments;
     QHash<DocumentModel::ScxmlDocument *, QString> classnameForDocument;
@@ -49,7 +55,8 @@ private:
                        const QString &className,
                        DocumentModel::ScxmlDocument *doc,
                        const QStringList &factory,
-                       const QScxmlInternal::GeneratedTableData::MetaDataInfo &info);
+                       const QScxmlInternal::GeneratedTableData::MetaDataInfo &info,
+                       const QScxmlInternal::GeneratedTableData::DataModelInfo &dataModelInfo);
     void writeImplEnd();
     QString mangleIdentifier(const QString &str);
 
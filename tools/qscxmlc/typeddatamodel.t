@@ -0,0 +1,31 @@
+
+void ${datamodel}::evaluateAssignment(QScxmlExecutableContent::EvaluatorId id, bool *ok)
+{
+    *ok = true;
+${evaluateAssignmentCases}
+    QScxmlCppDataModel::evaluateAssignment(id, ok);
+}
+
+void ${datamodel}::evaluateInitialization(QScxmlExecutableContent::EvaluatorId id, bool *ok)
+{
+    evaluateAssignment(id, ok);
+}
+
+QVariant ${datamodel}::scxmlProperty(const QString &name) const
+{
+${scxmlPropertyCases}
+    return QScxmlCppDataModel::scxmlProperty(name);
+}
+
+bool ${datamodel}::hasScxmlProperty(const QString &name) const
+{
+${hasScxmlPropertyCases}
+    return QScxmlCppDataModel::hasScxmlProperty(name);
+}
+
+bool ${datamodel}::setScxmlProperty(const QString &name, const QVariant &value,
+                                   const QString &context)
+{
+${setScxmlPropertyCases}
+    return QScxmlCppDataModel::setScxmlProperty(name, value, context);
+}